@@ -0,0 +1,268 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "RedBlackTree.h"
+using namespace std;
+
+/*  --------------------------------------------------------------
+ Thread-safe Red-Black Tree: any number of threads may search and run
+ range queries at the same time; writers take the tree for themselves.
+
+ Readers and writers are coordinated by a reader-biased exclusive lock. Each
+ reader registers in its own cache line, so concurrent lookups never write to
+ a shared location and lookup throughput scales with the number of cores.
+ Readers and a writer never overlap: a writer waits for the readers in
+ progress, and new readers wait until the writer is done. The lock suits
+ read-mostly loads; readers stall for the length of each write.
+
+ Nodes never leave the lock: lookups return copies of the values, and the
+ callbacks of forEachInRange() / read() run while the shared lock is held.
+*/
+
+// ------------------------ Reader-biased reader/writer lock ------------------------
+class ReaderBiasedLock {
+private:
+    static const size_t slotCount = 64;     // reader slots, one cache line each
+
+    struct alignas(64) Slot {
+        atomic<unsigned> readers;
+    };
+
+    Slot         slots[slotCount];
+    atomic<bool> writing;       // a writer holds or is acquiring the lock
+    mutex        writers;       // writers go one at a time
+
+    // Slot of the calling thread (threads are spread round robin over the slots)
+    static size_t mySlot() {
+        static atomic<size_t> nextSlot(0);
+        thread_local size_t   slot = nextSlot.fetch_add(1) % slotCount;
+        return slot;
+    }
+
+public:
+    ReaderBiasedLock() : writing(false) {
+        for (size_t i = 0; i < slotCount; i++)
+            slots[i].readers.store(0);
+    }
+    ReaderBiasedLock(const ReaderBiasedLock&) = delete;
+    ReaderBiasedLock& operator=(const ReaderBiasedLock&) = delete;
+
+    // Readers announce themselves first, then check for a writer: with both steps
+    // sequentially consistent, either the reader sees the writer or the writer sees
+    // the reader. A reader that meets a writer steps back and waits for it.
+    size_t lockShared() {
+        size_t slot = mySlot();
+        for (;;) {
+            slots[slot].readers.fetch_add(1);
+            if (!writing.load())
+                return slot;
+            slots[slot].readers.fetch_sub(1, memory_order_release);
+            while (writing.load(memory_order_acquire))
+                this_thread::yield();
+        }
+    }
+
+    void unlockShared(size_t slot) {
+        slots[slot].readers.fetch_sub(1, memory_order_release);
+    }
+
+    // The writer raises its flag, then checks every reader slot (the mirror image
+    // of lockShared(), so the loads are sequentially consistent too)
+    void lock() {
+        writers.lock();
+        writing.store(true);
+        for (size_t i = 0; i < slotCount; i++)
+            while (slots[i].readers.load() != 0)
+                this_thread::yield();
+    }
+
+    void unlock() {
+        writing.store(false, memory_order_release);
+        writers.unlock();
+    }
+};
+
+// Storage aligned to a cache line for objects holding a ReaderBiasedLock: new only
+// honours alignments above the default one from C++17 on. The start of the raw
+// block is kept just before the aligned address.
+inline void* allocateCacheAligned(size_t size) {
+    void*     raw = ::operator new(size + 64);
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + 64) & ~uintptr_t(63);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return reinterpret_cast<void*>(aligned);
+}
+
+inline void freeCacheAligned(void* p) {
+    if (p != nullptr)
+        ::operator delete(static_cast<void**>(p)[-1]);
+}
+
+// RAII guards for the two sides of the lock
+class SharedGuard {
+private:
+    ReaderBiasedLock& lock;
+    size_t            slot;
+
+public:
+    explicit SharedGuard(ReaderBiasedLock& l) : lock(l), slot(l.lockShared()) {}
+    ~SharedGuard() { lock.unlockShared(slot); }
+    SharedGuard(const SharedGuard&) = delete;
+    SharedGuard& operator=(const SharedGuard&) = delete;
+};
+
+class ExclusiveGuard {
+private:
+    ReaderBiasedLock& lock;
+
+public:
+    explicit ExclusiveGuard(ReaderBiasedLock& l) : lock(l) { lock.lock(); }
+    ~ExclusiveGuard() { lock.unlock(); }
+    ExclusiveGuard(const ExclusiveGuard&) = delete;
+    ExclusiveGuard& operator=(const ExclusiveGuard&) = delete;
+};
+
+// Concurrent Red-Black Tree class ==============================================================
+//  The tracing policy is fixed to NoTrace: the other policies record from search()
+//  and would race between readers.
+template <typename T, typename Augment = NoAugment>
+class ConcurrentRedBlackTree {
+public:
+    typedef RedBlackTree<T, Augment> Tree;
+
+private:
+    mutable ReaderBiasedLock lock;
+    Tree                     tree;
+
+public:
+    ConcurrentRedBlackTree() {}
+    ConcurrentRedBlackTree(const ConcurrentRedBlackTree&) = delete;
+    ConcurrentRedBlackTree& operator=(const ConcurrentRedBlackTree&) = delete;
+
+    // Readers - may run concurrently with each other, never with a writer
+    bool   contains(const T& val) const;
+    bool   find(const T& val, T& out) const;
+    bool   lowerBound(const T& val, T& out) const;
+    size_t size() const;
+    template <typename Fn>
+    void   forEachInRange(const T& lo, const T& hi, Fn fn) const;
+    // Run fn(const Tree&) under the shared lock (for several reads on one state)
+    template <typename Fn>
+    void   read(Fn fn) const;
+
+    // Writers - one at a time, once the readers in progress are done; new readers wait
+    void   insert(const T& val);
+    void   insert(T&& val);
+    template <typename... Args>
+    void   emplace(Args&&... args);
+    bool   erase(const T& val);
+    template <typename Iter>
+    void   insertBatch(Iter first, Iter last);
+    void   clear();
+    // Run fn(Tree&) under the exclusive lock (for read-modify-write sequences)
+    template <typename Fn>
+    void   write(Fn fn);
+};
+// ------------------------------------------------------------------------------------------------
+
+// Is val in the tree?
+template <typename T, typename Augment>
+bool ConcurrentRedBlackTree<T, Augment>::contains(const T& val) const {
+    SharedGuard guard(lock);
+    return tree.search(val) != nullptr;
+}
+
+// Copy the value equal to val into out. Returns false when val is not in the tree.
+template <typename T, typename Augment>
+bool ConcurrentRedBlackTree<T, Augment>::find(const T& val, T& out) const {
+    SharedGuard guard(lock);
+    typename Tree::TreeNode* node = tree.search(val);
+    if (node == nullptr)
+        return false;
+    out = node->data;
+    return true;
+}
+
+// Copy the first value not less than val into out. Returns false when there is none.
+template <typename T, typename Augment>
+bool ConcurrentRedBlackTree<T, Augment>::lowerBound(const T& val, T& out) const {
+    SharedGuard guard(lock);
+    typename Tree::TreeNode* node = tree.lower_bound(val);
+    if (node == nullptr)
+        return false;
+    out = node->data;
+    return true;
+}
+
+template <typename T, typename Augment>
+size_t ConcurrentRedBlackTree<T, Augment>::size() const {
+    SharedGuard guard(lock);
+    return tree.size();
+}
+
+// Call fn(data) for every value in [lo, hi), holding the shared lock
+template <typename T, typename Augment>
+template <typename Fn>
+void ConcurrentRedBlackTree<T, Augment>::forEachInRange(const T& lo, const T& hi, Fn fn) const {
+    SharedGuard guard(lock);
+    tree.forEachInRange(lo, hi, fn);
+}
+
+template <typename T, typename Augment>
+template <typename Fn>
+void ConcurrentRedBlackTree<T, Augment>::read(Fn fn) const {
+    SharedGuard guard(lock);
+    fn(static_cast<const Tree&>(tree));
+}
+
+// Writers -----------------------------------------------------------------
+template <typename T, typename Augment>
+void ConcurrentRedBlackTree<T, Augment>::insert(const T& val) {
+    ExclusiveGuard guard(lock);
+    tree.insert(val);
+}
+
+template <typename T, typename Augment>
+void ConcurrentRedBlackTree<T, Augment>::insert(T&& val) {
+    ExclusiveGuard guard(lock);
+    tree.insert(std::move(val));
+}
+
+template <typename T, typename Augment>
+template <typename... Args>
+void ConcurrentRedBlackTree<T, Augment>::emplace(Args&&... args) {
+    ExclusiveGuard guard(lock);
+    tree.emplace(std::forward<Args>(args)...);
+}
+
+template <typename T, typename Augment>
+bool ConcurrentRedBlackTree<T, Augment>::erase(const T& val) {
+    ExclusiveGuard guard(lock);
+    return tree.erase(val);
+}
+
+template <typename T, typename Augment>
+template <typename Iter>
+void ConcurrentRedBlackTree<T, Augment>::insertBatch(Iter first, Iter last) {
+    // Sort outside the lock so readers are held up only while the tree changes
+    vector<T> batch(first, last);
+    if (!is_sorted(batch.begin(), batch.end()))
+        sort(batch.begin(), batch.end());
+
+    ExclusiveGuard guard(lock);
+    tree.insertBatch(batch.begin(), batch.end());
+}
+
+template <typename T, typename Augment>
+void ConcurrentRedBlackTree<T, Augment>::clear() {
+    ExclusiveGuard guard(lock);
+    tree.clear();
+}
+
+template <typename T, typename Augment>
+template <typename Fn>
+void ConcurrentRedBlackTree<T, Augment>::write(Fn fn) {
+    ExclusiveGuard guard(lock);
+    fn(tree);
+}
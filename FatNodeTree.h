@@ -0,0 +1,523 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include "RedBlackTree.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RBT_FAT_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RBT_FAT_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RBT_FAT_NEON
+#endif
+using namespace std;
+
+/*  --------------------------------------------------------------
+ Fat-node search tree for arithmetic keys: FatNodeTree<T>.
+
+ A red-black tree is a binary encoding of a 2-3-4 tree: a black node and its
+ red children are one 2-3-4 node of up to 3 keys, and the color flips of
+ fixInsertion() are the splits of full 2-3-4 nodes. This tree keeps the
+ 2-3-4 algorithms but widens the nodes to 16 key slots (up to 15 keys and
+ 16 children), so one node covers about 4 levels of the binary tree:
+
+ - insert() splits every full node on its way down (top-down 2-3-4 insertion),
+   so a node always has room when the key reaches it and nothing propagates up.
+ - erase() tops up every minimal node on its way down (borrow or merge).
+ - All leaves are at the same depth and every node but the root is at least
+   half full, so the height is O(log n) as with the red-black tree.
+
+ Inside a node a search counts the keys less than the value instead of
+ branching on each of them. For 32-bit integers the count is done with
+ SSE2 / AVX2 / NEON compares over the 16 slots; other types use a plain loop
+ that the compiler can vectorize. Unused slots hold the largest value of T
+ (+infinity for floating point), so they are never counted as less than a key
+ and the count needs no mask; it is still clamped to the number of keys, since
+ a NaN breaks every comparison. NaN keys can be stored and erased, but have no
+ place in the order (as with std::set, nothing is found reliably around them).
+
+ Equal keys are allowed and go to the right of the ones already there,
+ as in RedBlackTree. search() and lower_bound() return pointers into the
+ nodes, valid until the next insert() or erase().
+*/
+
+// ------------------------ Fat nodes ------------------------
+static const int fatSlots   = 16;               // key slots per node
+static const int fatMaxKeys = fatSlots - 1;     // a full node
+static const int fatMinKeys = fatSlots / 2 - 1; // nodes other than the root never have fewer
+
+// A leaf holds keys only; an inner node adds the children (fatSlots of them).
+// Nodes are aligned for the vector loads (and for the free list of the pools).
+template <typename T>
+struct alignas(16) FatLeaf {
+    T       keys[fatSlots];
+    uint8_t count;
+    bool    leaf;
+};
+
+template <typename T>
+struct FatInner : public FatLeaf<T> {
+    FatLeaf<T>* children[fatSlots];
+};
+
+// Number of keys of a node that are less than val (the unused slots never are)
+template <typename T>
+inline int fatCountLess(const T* keys, const T& val) {
+    int less = 0;
+    for (int i = 0; i < fatSlots; i++)
+        less += int(keys[i] < val);
+    return less;
+}
+
+#if defined(RBT_FAT_AVX2)
+inline int fatCountLess(const int32_t* keys, const int32_t& val) {
+    // Each compare gives -1 in the lanes of the keys less than val
+    __m256i v    = _mm256_set1_epi32(val);
+    __m256i both = _mm256_add_epi32(
+        _mm256_cmpgt_epi32(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys))),
+        _mm256_cmpgt_epi32(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + 8))));
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(both), _mm256_extracti128_si256(both, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return -_mm_cvtsi128_si32(sum);
+}
+#elif defined(RBT_FAT_SSE2)
+inline int fatCountLess(const int32_t* keys, const int32_t& val) {
+    // Each compare gives -1 in the lanes of the keys less than val
+    __m128i v   = _mm_set1_epi32(val);
+    __m128i sum = _mm_add_epi32(
+        _mm_add_epi32(_mm_cmplt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys)), v),
+                      _mm_cmplt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + 4)), v)),
+        _mm_add_epi32(_mm_cmplt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + 8)), v),
+                      _mm_cmplt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + 12)), v)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return -_mm_cvtsi128_si32(sum);
+}
+#elif defined(RBT_FAT_NEON)
+inline int fatCountLess(const int32_t* keys, const int32_t& val) {
+    int32x4_t v   = vdupq_n_s32(val);
+    int32x4_t sum = vaddq_s32(
+        vaddq_s32(vreinterpretq_s32_u32(vcltq_s32(vld1q_s32(keys), v)),
+                  vreinterpretq_s32_u32(vcltq_s32(vld1q_s32(keys + 4), v))),
+        vaddq_s32(vreinterpretq_s32_u32(vcltq_s32(vld1q_s32(keys + 8), v)),
+                  vreinterpretq_s32_u32(vcltq_s32(vld1q_s32(keys + 12), v))));
+    return -vaddvq_s32(sum);
+}
+#endif
+
+// Fat-node tree class =============================================================================
+template <typename T>
+class FatNodeTree {
+    static_assert(is_arithmetic<T>::value, "fat nodes hold arithmetic keys");
+
+public:
+    typedef FatLeaf<T>  Leaf;
+    typedef FatInner<T> Inner;
+
+private:
+    Leaf*            root;
+    size_t           keyCount;
+    int              levels;        // height in nodes (0 when empty)
+    NodePool<Leaf>   leaves;
+    NodePool<Inner>  inners;
+
+    static Inner* inner(Leaf* node) { return static_cast<Inner*>(node); }
+    static const T& unused() {
+        static const T value = numeric_limits<T>::has_infinity ? numeric_limits<T>::infinity()
+                                                               : numeric_limits<T>::max();
+        return value;
+    }
+
+    // Private helper functions
+    Leaf*      newNode(bool leaf);
+    void       freeNode(Leaf* node);
+    static int lessPosition(const Leaf* node, const T& val);
+    static int upperPosition(const Leaf* node, const T& val);
+    static void insertKey(Leaf* node, int pos, const T& val, Leaf* rightChild);
+    static void removeKey(Leaf* node, int pos, bool withRightChild);
+    void       splitChild(Inner* parent, int i);
+    void       mergeChildren(Inner* parent, int i);
+    void       topUpChild(Inner* parent, int& i);
+    template <typename Fn>
+    static void forEachNode(const Leaf* node, Fn& fn);
+    template <typename Fn>
+    static void forEachNodeInRange(const Leaf* node, const T& lo, const T& hi, Fn& fn);
+
+public:
+    FatNodeTree() : root(nullptr), keyCount(0), levels(0) {}
+    ~FatNodeTree() { clear(); }
+
+    // The nodes belong to the tree's pools: it can be moved, not copied
+    FatNodeTree(const FatNodeTree&) = delete;
+    FatNodeTree& operator=(const FatNodeTree&) = delete;
+    FatNodeTree(FatNodeTree&& other) noexcept;
+    FatNodeTree& operator=(FatNodeTree&& other) noexcept;
+
+    // Public interface - same meaning as in RedBlackTree
+    void     insert(const T& val);
+    bool     erase(const T& val);
+    void     clear();
+    size_t   size() const   { return keyCount; }
+    bool     empty() const  { return keyCount == 0; }
+    int      height() const { return levels; }
+    const T* search(const T& val) const;
+    bool     contains(const T& val) const { return search(val) != nullptr; }
+    const T* lower_bound(const T& val) const;
+
+    // Call fn(key) for every key in sorted order / for every key in [lo, hi)
+    template <typename Fn>
+    void     forEach(Fn fn) const { if (root != nullptr) forEachNode(root, fn); }
+    template <typename Fn>
+    void     forEachInRange(const T& lo, const T& hi, Fn fn) const;
+};
+// ------------------------------------------------------------------------------------------------
+
+template <typename T>
+FatNodeTree<T>::FatNodeTree(FatNodeTree&& other) noexcept
+    : root(other.root), keyCount(other.keyCount), levels(other.levels),
+      leaves(std::move(other.leaves)), inners(std::move(other.inners)) {
+    other.root = nullptr;
+    other.keyCount = 0;
+    other.levels = 0;
+}
+
+template <typename T>
+FatNodeTree<T>& FatNodeTree<T>::operator=(FatNodeTree&& other) noexcept {
+    if (this != &other) {
+        clear();
+        std::swap(root, other.root);
+        std::swap(keyCount, other.keyCount);
+        std::swap(levels, other.levels);
+        leaves.swap(other.leaves);
+        inners.swap(other.inners);
+    }
+    return *this;
+}
+
+// Helper function to get an empty node, every slot unused
+template <typename T>
+typename FatNodeTree<T>::Leaf* FatNodeTree<T>::newNode(bool leaf) {
+    Leaf* node = leaf ? leaves.allocate() : inners.allocate();
+    for (int i = 0; i < fatSlots; i++)
+        node->keys[i] = unused();
+    node->count = 0;
+    node->leaf = leaf;
+    if (!leaf)
+        for (int i = 0; i < fatSlots; i++)
+            inner(node)->children[i] = nullptr;
+    return node;
+}
+
+template <typename T>
+void FatNodeTree<T>::freeNode(Leaf* node) {
+    if (node->leaf)
+        leaves.deallocate(node);
+    else
+        inners.deallocate(inner(node));
+}
+
+// Number of keys of node less than val, at most node->count
+template <typename T>
+int FatNodeTree<T>::lessPosition(const Leaf* node, const T& val) {
+    int pos = fatCountLess(node->keys, val);
+    return pos < node->count ? pos : node->count;
+}
+
+// Position for a new copy of val in node: after the keys not greater than val
+template <typename T>
+int FatNodeTree<T>::upperPosition(const Leaf* node, const T& val) {
+    int pos = lessPosition(node, val);
+    while (pos < node->count && !(val < node->keys[pos]))
+        pos++;
+    return pos;
+}
+
+// Helper function to put val at pos of a node that has room, with its right
+// child (inner nodes) just after it
+template <typename T>
+void FatNodeTree<T>::insertKey(Leaf* node, int pos, const T& val, Leaf* rightChild) {
+    for (int i = node->count; i > pos; i--)
+        node->keys[i] = node->keys[i - 1];
+    node->keys[pos] = val;
+    if (!node->leaf) {
+        Inner* in = inner(node);
+        for (int i = node->count + 1; i > pos + 1; i--)
+            in->children[i] = in->children[i - 1];
+        in->children[pos + 1] = rightChild;
+    }
+    node->count++;
+}
+
+// Helper function to take out the key at pos with its right child (or its left
+// child when withRightChild is false - used for the first key)
+template <typename T>
+void FatNodeTree<T>::removeKey(Leaf* node, int pos, bool withRightChild) {
+    for (int i = pos; i + 1 < node->count; i++)
+        node->keys[i] = node->keys[i + 1];
+    if (!node->leaf) {
+        Inner* in = inner(node);
+        for (int i = pos + (withRightChild ? 1 : 0); i < node->count; i++)
+            in->children[i] = in->children[i + 1];
+        in->children[node->count] = nullptr;
+    }
+    node->count--;
+    node->keys[node->count] = unused();
+}
+
+// Split the full child i of parent around its middle key, which moves up into parent
+// (the 2-3-4 split that the color flip of fixInsertion stands for)
+template <typename T>
+void FatNodeTree<T>::splitChild(Inner* parent, int i) {
+    Leaf* full = parent->children[i];
+    Leaf* right = newNode(full->leaf);
+    const int middle = fatMaxKeys / 2;
+
+    for (int k = middle + 1; k < fatMaxKeys; k++) {
+        right->keys[k - middle - 1] = full->keys[k];
+        full->keys[k] = unused();
+    }
+    right->count = uint8_t(fatMaxKeys - middle - 1);
+    if (!full->leaf)
+        for (int k = middle + 1; k <= fatMaxKeys; k++) {
+            inner(right)->children[k - middle - 1] = inner(full)->children[k];
+            inner(full)->children[k] = nullptr;
+        }
+
+    T up = full->keys[middle];
+    full->keys[middle] = unused();
+    full->count = uint8_t(middle);
+    insertKey(parent, i, up, right);
+}
+
+// Merge child i + 1 of parent and the key between them into child i
+template <typename T>
+void FatNodeTree<T>::mergeChildren(Inner* parent, int i) {
+    Leaf* left = parent->children[i];
+    Leaf* right = parent->children[i + 1];
+
+    left->keys[left->count] = parent->keys[i];
+    for (int k = 0; k < right->count; k++)
+        left->keys[left->count + 1 + k] = right->keys[k];
+    if (!left->leaf)
+        for (int k = 0; k <= right->count; k++)
+            inner(left)->children[left->count + 1 + k] = inner(right)->children[k];
+    left->count = uint8_t(left->count + 1 + right->count);
+
+    removeKey(parent, i, true);
+    freeNode(right);
+}
+
+// Give child i of parent more than the minimum number of keys before the descent
+// goes into it: borrow through parent from a sibling that can spare a key, or
+// merge with a sibling. i is updated when child i is merged into its left sibling.
+template <typename T>
+void FatNodeTree<T>::topUpChild(Inner* parent, int& i) {
+    Leaf* child = parent->children[i];
+    if (child->count > fatMinKeys)
+        return;
+
+    if (i > 0 && parent->children[i - 1]->count > fatMinKeys) {
+        // Rotate right: the separator comes down, the last key of the left sibling goes up
+        Leaf* left = parent->children[i - 1];
+        for (int k = child->count; k > 0; k--)
+            child->keys[k] = child->keys[k - 1];
+        child->keys[0] = parent->keys[i - 1];
+        if (!child->leaf) {
+            Inner* in = inner(child);
+            for (int k = child->count + 1; k > 0; k--)
+                in->children[k] = in->children[k - 1];
+            in->children[0] = inner(left)->children[left->count];
+        }
+        child->count++;
+        parent->keys[i - 1] = left->keys[left->count - 1];
+        removeKey(left, left->count - 1, true);
+    }
+    else if (i < parent->count && parent->children[i + 1]->count > fatMinKeys) {
+        // Rotate left: the separator comes down, the first key of the right sibling goes up
+        Leaf* right = parent->children[i + 1];
+        Leaf* moved = right->leaf ? nullptr : inner(right)->children[0];
+        insertKey(child, child->count, parent->keys[i], moved);
+        parent->keys[i] = right->keys[0];
+        removeKey(right, 0, false);
+    }
+    else if (i < parent->count)
+        mergeChildren(parent, i);
+    else {
+        mergeChildren(parent, i - 1);
+        i--;
+    }
+}
+
+// Top-down insertion: every full node on the path is split before the descent
+// enters it, so the leaf reached always has room for val
+template <typename T>
+void FatNodeTree<T>::insert(const T& val) {
+    if (root == nullptr) {
+        root = newNode(true);
+        levels = 1;
+    }
+    if (root->count == fatMaxKeys) {
+        Inner* top = inner(newNode(false));
+        top->children[0] = root;
+        root = top;
+        splitChild(top, 0);
+        levels++;
+    }
+
+    Leaf* node = root;
+    while (!node->leaf) {
+        int i = upperPosition(node, val);
+        if (inner(node)->children[i]->count == fatMaxKeys) {
+            splitChild(inner(node), i);
+            if (!(val < node->keys[i]))
+                i++;
+        }
+        node = inner(node)->children[i];
+    }
+    insertKey(node, upperPosition(node, val), val, nullptr);
+    keyCount++;
+}
+
+// Top-down deletion of one copy of val: every node the descent enters has a key
+// to spare, so removing from a leaf never leaves it underfull.
+// Returns false when val is not in the tree.
+template <typename T>
+bool FatNodeTree<T>::erase(const T& val) {
+    Leaf* node = root;
+    T     target = val;     // the key to remove (a predecessor/successor of val after case 2)
+    bool  found = false;
+
+    while (node != nullptr) {
+        int pos = lessPosition(node, target);
+        bool here = pos < node->count && !(target < node->keys[pos]);
+
+        if (node->leaf) {
+            if (!here)
+                break;
+            removeKey(node, pos, true);
+            found = true;
+            break;
+        }
+
+        Inner* in = inner(node);
+        if (here) {
+            // The key is in an inner node: replace it with its neighbour from a child
+            // that can spare one, or merge the two children around it and go on there
+            Leaf* left = in->children[pos];
+            Leaf* right = in->children[pos + 1];
+            if (left->count > fatMinKeys) {
+                Leaf* last = left;
+                while (!last->leaf)
+                    last = inner(last)->children[last->count];
+                node->keys[pos] = target = last->keys[last->count - 1];
+                node = left;
+            }
+            else if (right->count > fatMinKeys) {
+                Leaf* first = right;
+                while (!first->leaf)
+                    first = inner(first)->children[0];
+                node->keys[pos] = target = first->keys[0];
+                node = right;
+            }
+            else {
+                mergeChildren(in, pos);
+                node = left;
+            }
+        }
+        else {
+            topUpChild(in, pos);
+            node = in->children[pos];
+        }
+
+        // A merge can empty the root: its only child takes its place
+        if (root->count == 0 && !root->leaf) {
+            Leaf* old = root;
+            root = inner(root)->children[0];
+            freeNode(old);
+            levels--;
+        }
+    }
+
+    if (found) {
+        keyCount--;
+        if (keyCount == 0)
+            clear();
+    }
+    return found;
+}
+
+// Keys are arithmetic (nothing to destroy): the pools are released in O(blocks)
+template <typename T>
+void FatNodeTree<T>::clear() {
+    root = nullptr;
+    keyCount = 0;
+    levels = 0;
+    leaves.release();
+    inners.release();
+}
+
+// Search for a key equal to val: one vector count per node
+template <typename T>
+const T* FatNodeTree<T>::search(const T& val) const {
+    const Leaf* node = root;
+    while (node != nullptr) {
+        int pos = lessPosition(node, val);
+        if (pos < node->count && !(val < node->keys[pos]))
+            return node->keys + pos;
+        node = node->leaf ? nullptr : static_cast<const Inner*>(node)->children[pos];
+    }
+    return nullptr;
+}
+
+// Return the first key not less than val (nullptr if there is none)
+template <typename T>
+const T* FatNodeTree<T>::lower_bound(const T& val) const {
+    const T*    result = nullptr;
+    const Leaf* node = root;
+    while (node != nullptr) {
+        int pos = lessPosition(node, val);
+        if (pos < node->count)
+            result = node->keys + pos;
+        node = node->leaf ? nullptr : static_cast<const Inner*>(node)->children[pos];
+    }
+    return result;
+}
+
+// Inorder walk helper for the traversals (recursion depth is the height, a few levels)
+template <typename T>
+template <typename Fn>
+void FatNodeTree<T>::forEachNode(const Leaf* node, Fn& fn) {
+    const Inner* in = node->leaf ? nullptr : static_cast<const Inner*>(node);
+    for (int i = 0; i < node->count; i++) {
+        if (in != nullptr)
+            forEachNode(in->children[i], fn);
+        fn(node->keys[i]);
+    }
+    if (in != nullptr)
+        forEachNode(in->children[node->count], fn);
+}
+
+// Range walk helper: only the children that can hold keys in [lo, hi) are visited
+template <typename T>
+template <typename Fn>
+void FatNodeTree<T>::forEachNodeInRange(const Leaf* node, const T& lo, const T& hi, Fn& fn) {
+    const Inner* in = node->leaf ? nullptr : static_cast<const Inner*>(node);
+    for (int i = lessPosition(node, lo); i <= node->count; i++) {
+        if (in != nullptr)
+            forEachNodeInRange(in->children[i], lo, hi, fn);
+        if (i == node->count || !(node->keys[i] < hi))
+            return;
+        fn(node->keys[i]);
+    }
+}
+
+template <typename T>
+template <typename Fn>
+void FatNodeTree<T>::forEachInRange(const T& lo, const T& hi, Fn fn) const {
+    if (root != nullptr && lo < hi)
+        forEachNodeInRange(root, lo, hi, fn);
+}
@@ -0,0 +1,559 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "RedBlackTree.h"
+using namespace std;
+
+/*  --------------------------------------------------------------
+ Red-Black Tree with 32-bit links: IndexedRedBlackTree<T>.
+
+ The nodes live in one contiguous vector and refer to each other by their
+ index in it instead of by address. The three links take 12 bytes instead of
+ 24 on a 64-bit build, and the color goes into the top bit of the parent
+ index, so the links and the color together take 12 bytes
+ (16 per node for T = int, against 40 for Node<int>, or 32 in compact mode).
+
+ As no link is an address, the tree is relocatable: it can be copied or moved
+ with its vector, and the node array can be written to a file or mapped as is
+ (getNodes() / getRoot() give the raw layout).
+
+ The algorithms are those of RedBlackTree (same rotations, same fix-up cases,
+ equal keys to the right). Handles (node indices) stay valid until the node is
+ erased; erased slots are reused by later inserts (the value of an erased node
+ stays in its slot until then). References to values are invalidated when the
+ vector grows: keep handles rather than pointers. A tree holds at most
+ 2^31 - 1 nodes (insert() throws length_error beyond, as vector does).
+*/
+
+// Index standing for "no node" (also the largest index + 1)
+static const uint32_t indexedNil = 0x7FFFFFFFu;
+
+// ------------------------ Node structure for the indexed tree ------------------------
+template <typename T>
+struct IndexedNode {
+    T        data;
+    uint32_t left;
+    uint32_t right;
+
+    // Accessors for the parent index and the color (stored in the top bit, BLACK = 1)
+    uint32_t getParent() const     { return parentAndColor & indexedNil; }
+    void     setParent(uint32_t p) { parentAndColor = (parentAndColor & ~indexedNil) | p; }
+    int      getColor() const      { return int(parentAndColor >> 31); }
+    void     setColor(int c)       { parentAndColor = (parentAndColor & indexedNil) | (uint32_t(c) << 31); }
+
+    template <typename... Args>
+    IndexedNode(EmplaceTag, Args&&... args)
+        : data(std::forward<Args>(args)...), left(indexedNil), right(indexedNil),
+          parentAndColor(indexedNil) {}
+
+private:
+    uint32_t parentAndColor;
+};
+
+// Indexed Red-Black Tree class ===================================================================
+template <typename T>
+class IndexedRedBlackTree {
+public:
+    typedef IndexedNode<T> TreeNode;
+
+private:
+    vector<TreeNode> nodes;         // every node, live or free
+    uint32_t         root;
+    uint32_t         freeList;      // erased slots, chained by their right link
+    size_t           nodeCount;
+
+    TreeNode&       at(uint32_t i)       { return nodes[i]; }
+    const TreeNode& at(uint32_t i) const { return nodes[i]; }
+    int             colorOf(uint32_t i) const { return i == indexedNil ? BLACK : nodes[i].getColor(); }
+
+    // Private helper functions
+    void     rotateLeft(uint32_t x);
+    void     rotateRight(uint32_t x);
+    void     fixInsertion(uint32_t x);
+    void     fixDeletion(uint32_t x, uint32_t xParent);
+    void     transplant(uint32_t u, uint32_t v);
+    template <typename... Args>
+    uint32_t createNode(Args&&... args);
+    uint32_t insertNode(uint32_t newNode);
+
+public:
+    // Bidirectional iterator over the values in sorted order (walks the parent links)
+    class iterator {
+    public:
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef T                          value_type;
+        typedef ptrdiff_t                  difference_type;
+        typedef const T*                   pointer;
+        typedef const T&                   reference;
+
+        iterator() : tree(nullptr), current(indexedNil) {}
+        // indexedNil is the end() position of the tree
+        iterator(const IndexedRedBlackTree* t, uint32_t node) : tree(t), current(node) {}
+
+        reference operator*() const  { return tree->value(current); }
+        pointer   operator->() const { return &tree->value(current); }
+        uint32_t  handle() const     { return current; }
+
+        iterator& operator++() { current = tree->successor(current); return *this; }
+        iterator  operator++(int) { iterator old = *this; ++*this; return old; }
+        iterator& operator--() {
+            current = (current == indexedNil ? tree->maximum() : tree->predecessor(current));
+            return *this;
+        }
+        iterator  operator--(int) { iterator old = *this; --*this; return old; }
+
+        bool operator==(const iterator& other) const { return current == other.current; }
+        bool operator!=(const iterator& other) const { return current != other.current; }
+
+    private:
+        const IndexedRedBlackTree* tree;
+        uint32_t                   current;
+    };
+    typedef iterator const_iterator;
+
+    IndexedRedBlackTree() : root(indexedNil), freeList(indexedNil), nodeCount(0) {}
+
+    // Public interface - insert() and emplace() return the handle of the new node,
+    // search() and lower_bound() return indexedNil when there is no such node
+    uint32_t insert(const T& val)  { return insertNode(createNode(val)); }
+    uint32_t insert(T&& val)       { return insertNode(createNode(std::move(val))); }
+    template <typename... Args>
+    uint32_t emplace(Args&&... args) { return insertNode(createNode(std::forward<Args>(args)...)); }
+    bool     erase(const T& val);
+    void     erase(uint32_t z);
+    void     clear();
+    void     reserve(size_t n) { nodes.reserve(n); }
+    size_t   size() const      { return nodeCount; }
+    bool     empty() const     { return nodeCount == 0; }
+    uint32_t search(const T& val) const;
+    bool     contains(const T& val) const { return search(val) != indexedNil; }
+    uint32_t lower_bound(const T& val) const;
+    void     print() const;
+
+    // Handles - value of a node, and the neighbours in sorted order
+    const T& value(uint32_t handle) const { return nodes[handle].data; }
+    uint32_t minimum() const;
+    uint32_t maximum() const;
+    uint32_t successor(uint32_t node) const;
+    uint32_t predecessor(uint32_t node) const;
+
+    // Iteration in sorted order
+    iterator begin() const { return iterator(this, minimum()); }
+    iterator end() const   { return iterator(this, indexedNil); }
+
+    // Raw layout (free slots included) for serialization
+    const vector<TreeNode>& getNodes() const { return nodes; }
+    uint32_t                getRoot() const  { return root; }
+};
+// ------------------------------------------------------------------------------------------------
+
+// Helper function to build a node in a free slot, or at the end of the vector
+template <typename T>
+template <typename... Args>
+uint32_t IndexedRedBlackTree<T>::createNode(Args&&... args) {
+    if (freeList != indexedNil) {
+        uint32_t slot = freeList;
+        freeList = at(slot).right;
+        at(slot) = TreeNode(EmplaceTag(), std::forward<Args>(args)...);
+        return slot;
+    }
+    if (nodes.size() >= indexedNil)
+        throw length_error("IndexedRedBlackTree: too many nodes for 31-bit indices");
+    if (nodes.size() == nodes.capacity()) {
+        // The arguments may refer to a value in nodes (insert(value(h))): build the
+        // node before the vector grows and frees the old array
+        TreeNode node(EmplaceTag(), std::forward<Args>(args)...);
+        nodes.push_back(std::move(node));
+    }
+    else
+        nodes.emplace_back(EmplaceTag(), std::forward<Args>(args)...);
+    return uint32_t(nodes.size() - 1);
+}
+
+// Insertion - one comparison per level, equal keys go to the right
+template <typename T>
+uint32_t IndexedRedBlackTree<T>::insertNode(uint32_t newNode) {
+    nodeCount++;
+    if (root == indexedNil) {
+        // If tree is empty, make new node as root and color it black
+        root = newNode;
+        at(root).setColor(BLACK);
+        return newNode;
+    }
+
+    const T& val = at(newNode).data;
+    uint32_t current = root;
+    uint32_t parent = indexedNil;
+    bool     goLeft = false;
+    while (current != indexedNil) {
+        parent = current;
+        goLeft = val < at(current).data;
+        current = goLeft ? at(current).left : at(current).right;
+    }
+
+    at(newNode).setParent(parent);
+    if (goLeft)
+        at(parent).left = newNode;
+    else
+        at(parent).right = newNode;
+
+    fixInsertion(newNode);
+    return newNode;
+}
+
+// Fix violations of Red-Black Tree properties after insertion (cases of RedBlackTree)
+template <typename T>
+void IndexedRedBlackTree<T>::fixInsertion(uint32_t x) {
+    while (x != root && at(at(x).getParent()).getColor() == RED) {
+        uint32_t parent = at(x).getParent();
+        uint32_t grandparent = at(parent).getParent();
+
+        //Is the parent a left child?
+        if (parent == at(grandparent).left) {
+            uint32_t uncle = at(grandparent).right;
+            if (colorOf(uncle) == RED) {
+                // Case 1: Parent and uncle are both red
+                at(parent).setColor(BLACK);
+                at(uncle).setColor(BLACK);
+                at(grandparent).setColor(RED);
+                x = grandparent;
+            }
+            else {
+                // Case 2: Parent is red but uncle is black or absent
+                if (x == at(parent).right) {
+                    x = parent;
+                    rotateLeft(x);
+                }
+                // Case 3: Parent is red, uncle is black, and x is left child
+                parent = at(x).getParent();
+                grandparent = at(parent).getParent();
+                at(parent).setColor(BLACK);
+                at(grandparent).setColor(RED);
+                rotateRight(grandparent);
+            }
+        }
+        else {
+            // Symmetric cases for a parent that is a right child
+            uint32_t uncle = at(grandparent).left;
+            if (colorOf(uncle) == RED) {
+                at(parent).setColor(BLACK);
+                at(uncle).setColor(BLACK);
+                at(grandparent).setColor(RED);
+                x = grandparent;
+            }
+            else {
+                if (x == at(parent).left) {
+                    x = parent;
+                    rotateRight(x);
+                }
+                parent = at(x).getParent();
+                grandparent = at(parent).getParent();
+                at(parent).setColor(BLACK);
+                at(grandparent).setColor(RED);
+                rotateLeft(grandparent);
+            }
+        }
+    }
+
+    // Make sure the root is ALWAYS black
+    at(root).setColor(BLACK);
+}
+
+// Left rotation around x (see RedBlackTree::rotateLeft)
+template <typename T>
+void IndexedRedBlackTree<T>::rotateLeft(uint32_t x) {
+    uint32_t y = at(x).right;
+    uint32_t xParent = at(x).getParent();
+
+    at(x).right = at(y).left;
+    if (at(y).left != indexedNil)
+        at(at(y).left).setParent(x);
+
+    at(y).setParent(xParent);
+    if (xParent == indexedNil)
+        root = y;
+    else if (x == at(xParent).left)
+        at(xParent).left = y;
+    else
+        at(xParent).right = y;
+
+    at(y).left = x;
+    at(x).setParent(y);
+}
+
+// Right rotation around x (see RedBlackTree::rotateRight)
+template <typename T>
+void IndexedRedBlackTree<T>::rotateRight(uint32_t x) {
+    uint32_t y = at(x).left;
+    uint32_t xParent = at(x).getParent();
+
+    at(x).left = at(y).right;
+    if (at(y).right != indexedNil)
+        at(at(y).right).setParent(x);
+
+    at(y).setParent(xParent);
+    if (xParent == indexedNil)
+        root = y;
+    else if (x == at(xParent).right)
+        at(xParent).right = y;
+    else
+        at(xParent).left = y;
+
+    at(y).right = x;
+    at(x).setParent(y);
+}
+
+// Deletion functions ------------------------------------------------------
+// Remove one node holding val. Returns false when val is not in the tree.
+template <typename T>
+bool IndexedRedBlackTree<T>::erase(const T& val) {
+    uint32_t z = search(val);
+    if (z == indexedNil)
+        return false;
+    erase(z);
+    return true;
+}
+
+// Remove node z. Nodes are relinked, not moved, so every other handle stays valid;
+// the slot of z goes on the free list.
+template <typename T>
+void IndexedRedBlackTree<T>::erase(uint32_t z) {
+    uint32_t y = z;                     // node actually unlinked from its position
+    int      yOriginalColor = at(y).getColor();
+    uint32_t x;                         // node moving into y's position (may be indexedNil)
+    uint32_t xParent;                   // parent of x, also when x is indexedNil
+
+    if (at(z).left == indexedNil) {
+        x = at(z).right;
+        xParent = at(z).getParent();
+        transplant(z, x);
+    }
+    else if (at(z).right == indexedNil) {
+        x = at(z).left;
+        xParent = at(z).getParent();
+        transplant(z, x);
+    }
+    else {
+        // Two children: z is replaced by its successor y, the minimum of the right subtree
+        y = at(z).right;
+        while (at(y).left != indexedNil)
+            y = at(y).left;
+        yOriginalColor = at(y).getColor();
+        x = at(y).right;
+
+        if (at(y).getParent() == z)
+            xParent = y;
+        else {
+            xParent = at(y).getParent();
+            transplant(y, at(y).right);
+            at(y).right = at(z).right;
+            at(at(y).right).setParent(y);
+        }
+        transplant(z, y);
+        at(y).left = at(z).left;
+        at(at(y).left).setParent(y);
+        at(y).setColor(at(z).getColor());
+    }
+
+    // Removing a black node shortens the black height of x's path
+    if (yOriginalColor == BLACK)
+        fixDeletion(x, xParent);
+
+    at(z).left = indexedNil;
+    at(z).right = freeList;
+    freeList = z;
+    nodeCount--;
+}
+
+// Replace the subtree rooted at u with the subtree rooted at v
+template <typename T>
+void IndexedRedBlackTree<T>::transplant(uint32_t u, uint32_t v) {
+    uint32_t uParent = at(u).getParent();
+    if (uParent == indexedNil)
+        root = v;
+    else if (u == at(uParent).left)
+        at(uParent).left = v;
+    else
+        at(uParent).right = v;
+    if (v != indexedNil)
+        at(v).setParent(uParent);
+}
+
+// Fix violations of Red-Black Tree properties after deletion (cases of RedBlackTree)
+// x carries an extra black; xParent is needed because x may be indexedNil
+template <typename T>
+void IndexedRedBlackTree<T>::fixDeletion(uint32_t x, uint32_t xParent) {
+    while (x != root && colorOf(x) == BLACK) {
+
+        //Is x a left child?
+        if (x == at(xParent).left) {
+            uint32_t sibling = at(xParent).right;
+            if (at(sibling).getColor() == RED) {
+                at(sibling).setColor(BLACK);
+                at(xParent).setColor(RED);
+                rotateLeft(xParent);
+                sibling = at(xParent).right;
+            }
+            if (colorOf(at(sibling).left) == BLACK && colorOf(at(sibling).right) == BLACK) {
+                at(sibling).setColor(RED);
+                x = xParent;
+                xParent = at(x).getParent();
+            }
+            else {
+                if (colorOf(at(sibling).right) == BLACK) {
+                    at(at(sibling).left).setColor(BLACK);
+                    at(sibling).setColor(RED);
+                    rotateRight(sibling);
+                    sibling = at(xParent).right;
+                }
+                at(sibling).setColor(at(xParent).getColor());
+                at(xParent).setColor(BLACK);
+                at(at(sibling).right).setColor(BLACK);
+                rotateLeft(xParent);
+                x = root;
+            }
+        }
+        else {
+            // Symmetric cases for x being a right child
+            uint32_t sibling = at(xParent).left;
+            if (at(sibling).getColor() == RED) {
+                at(sibling).setColor(BLACK);
+                at(xParent).setColor(RED);
+                rotateRight(xParent);
+                sibling = at(xParent).left;
+            }
+            if (colorOf(at(sibling).left) == BLACK && colorOf(at(sibling).right) == BLACK) {
+                at(sibling).setColor(RED);
+                x = xParent;
+                xParent = at(x).getParent();
+            }
+            else {
+                if (colorOf(at(sibling).left) == BLACK) {
+                    at(at(sibling).right).setColor(BLACK);
+                    at(sibling).setColor(RED);
+                    rotateLeft(sibling);
+                    sibling = at(xParent).left;
+                }
+                at(sibling).setColor(at(xParent).getColor());
+                at(xParent).setColor(BLACK);
+                at(at(sibling).left).setColor(BLACK);
+                rotateRight(xParent);
+                x = root;
+            }
+        }
+    }
+
+    if (x != indexedNil)
+        at(x).setColor(BLACK);
+}
+
+// Drop every node; the vector keeps its capacity for the next inserts
+template <typename T>
+void IndexedRedBlackTree<T>::clear() {
+    nodes.clear();
+    root = freeList = indexedNil;
+    nodeCount = 0;
+}
+
+// Search function - one comparison per level, as in RedBlackTree::search
+template <typename T>
+uint32_t IndexedRedBlackTree<T>::search(const T& val) const {
+    uint32_t candidate = indexedNil;
+    uint32_t node = root;
+    while (node != indexedNil) {
+        if (val < at(node).data)
+            node = at(node).left;
+        else {
+            candidate = node;
+            node = at(node).right;
+        }
+    }
+    return (candidate != indexedNil && !(at(candidate).data < val)) ? candidate : indexedNil;
+}
+
+// Return the first node whose data is not less than val (indexedNil if none)
+template <typename T>
+uint32_t IndexedRedBlackTree<T>::lower_bound(const T& val) const {
+    uint32_t result = indexedNil;
+    uint32_t node = root;
+    while (node != indexedNil) {
+        if (at(node).data < val)
+            node = at(node).right;
+        else {
+            result = node;
+            node = at(node).left;
+        }
+    }
+    return result;
+}
+
+template <typename T>
+uint32_t IndexedRedBlackTree<T>::minimum() const {
+    uint32_t node = root;
+    if (node != indexedNil)
+        while (at(node).left != indexedNil)
+            node = at(node).left;
+    return node;
+}
+
+template <typename T>
+uint32_t IndexedRedBlackTree<T>::maximum() const {
+    uint32_t node = root;
+    if (node != indexedNil)
+        while (at(node).right != indexedNil)
+            node = at(node).right;
+    return node;
+}
+
+// Next node in sorted order (indexedNil after the largest)
+template <typename T>
+uint32_t IndexedRedBlackTree<T>::successor(uint32_t node) const {
+    if (at(node).right != indexedNil) {
+        node = at(node).right;
+        while (at(node).left != indexedNil)
+            node = at(node).left;
+        return node;
+    }
+    uint32_t parent = at(node).getParent();
+    while (parent != indexedNil && node == at(parent).right) {
+        node = parent;
+        parent = at(parent).getParent();
+    }
+    return parent;
+}
+
+// Previous node in sorted order (indexedNil before the smallest)
+template <typename T>
+uint32_t IndexedRedBlackTree<T>::predecessor(uint32_t node) const {
+    if (at(node).left != indexedNil) {
+        node = at(node).left;
+        while (at(node).right != indexedNil)
+            node = at(node).right;
+        return node;
+    }
+    uint32_t parent = at(node).getParent();
+    while (parent != indexedNil && node == at(parent).left) {
+        node = parent;
+        parent = at(parent).getParent();
+    }
+    return parent;
+}
+
+// Print the tree in preorder, in the format of RedBlackTree::print()
+template <typename T>
+void IndexedRedBlackTree<T>::print() const {
+    vector<uint32_t> pending;
+    if (root != indexedNil)
+        pending.push_back(root);
+    while (!pending.empty()) {
+        uint32_t node = pending.back();
+        pending.pop_back();
+        cout << to_string(at(node).data) << (at(node).getColor() == RED ? "(RED)" : "(BLACK)") << " ";
+        if (at(node).right != indexedNil)
+            pending.push_back(at(node).right);
+        if (at(node).left != indexedNil)
+            pending.push_back(at(node).left);
+    }
+    cout << endl;
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include "RedBlackTree.h"
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+/*  --------------------------------------------------------------
+ Read-only Red-Black Tree served straight from a memory-mapped image
+ written by RedBlackTree::save() (layout in RedBlackTree.h, TreeImageHeader).
+
+ Opening checks the header and the file size only: nothing is deserialized,
+ and the pages of the image are read by the OS on first use. Searches walk
+ the stored left/right indices from the stored root just like search() walks
+ the pointers of the tree. Every index is bounds checked, so a damaged image
+ can give wrong answers but never makes a lookup read outside the mapping.
+
+ The view never changes. To apply writes, build a mutable tree with toTree()
+ (O(n), values are already sorted), update it and save() a new image.
+*/
+
+// Memory-mapped Red-Black Tree class ==============================================================
+template <typename T>
+class MappedRedBlackTree {
+    static_assert(is_trivially_copyable<T>::value, "an image holds trivially copyable values only");
+
+private:
+    const char*     base;       // start of the mapping (nullptr when closed)
+    size_t          length;     // size of the mapping in bytes
+    const T*        values;
+    const uint32_t* left;
+    const uint32_t* right;
+    const uint8_t*  black;
+    uint32_t        count;
+    uint32_t        root;
+#ifdef _WIN32
+    HANDLE          file;
+    HANDLE          mapping;
+#endif
+
+    // A red-black tree of fewer than 2^32 nodes is less than 64 levels deep:
+    // a longer walk can only come from a damaged image
+    static const int maxDepth = 64;
+
+    void unmap();
+
+public:
+    MappedRedBlackTree();
+    explicit MappedRedBlackTree(const string& path);
+    ~MappedRedBlackTree() { close(); }
+
+    // The view owns the mapping and cannot be copied
+    MappedRedBlackTree(const MappedRedBlackTree&) = delete;
+    MappedRedBlackTree& operator=(const MappedRedBlackTree&) = delete;
+
+    bool   open(const string& path);
+    void   close();
+    bool   isOpen() const { return base != nullptr; }
+
+    // Public interface - pointers into the mapping stay valid until close()
+    size_t   size() const  { return count; }
+    bool     empty() const { return count == 0; }
+    const T* search(const T& val) const;
+    bool     contains(const T& val) const { return search(val) != nullptr; }
+    const T* lower_bound(const T& val) const;
+    bool     isBlack(uint32_t index) const { return (black[index / 8] >> (index % 8)) & 1; }
+    template <typename Fn>
+    void     forEachInRange(const T& lo, const T& hi, Fn fn) const;
+
+    // Values in sorted order, as in the image
+    const T* begin() const { return values; }
+    const T* end() const   { return values + count; }
+
+    // Mutable copy of the tree (for writes)
+    RedBlackTree<T> toTree() const { return RedBlackTree<T>(begin(), end()); }
+};
+// ------------------------------------------------------------------------------------------------
+
+template <typename T>
+MappedRedBlackTree<T>::MappedRedBlackTree()
+    : base(nullptr), length(0), values(nullptr), left(nullptr), right(nullptr), black(nullptr),
+      count(0), root(treeImageNil) {
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+#endif
+}
+
+template <typename T>
+MappedRedBlackTree<T>::MappedRedBlackTree(const string& path) : MappedRedBlackTree() {
+    open(path);
+}
+
+// Map the image in path. Returns false if it cannot be mapped or is not a valid image.
+template <typename T>
+bool MappedRedBlackTree<T>::open(const string& path) {
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < LONGLONG(sizeof(TreeImageHeader))) {
+        close();
+        return false;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        close();
+        return false;
+    }
+    base = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    length = size_t(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < off_t(sizeof(TreeImageHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* address = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address != MAP_FAILED) {
+        base = static_cast<const char*>(address);
+        length = size_t(info.st_size);
+    }
+#endif
+    if (base == nullptr) {
+        close();
+        return false;
+    }
+
+    TreeImageHeader header;
+    memcpy(&header, base, sizeof(header));
+    TreeImageLayout layout(header.count, sizeof(T));
+    if (!validTreeImageHeader(header, uint32_t(sizeof(T))) || layout.total > length) {
+        close();
+        return false;
+    }
+
+    values = reinterpret_cast<const T*>(base + layout.values);
+    left   = reinterpret_cast<const uint32_t*>(base + layout.left);
+    right  = reinterpret_cast<const uint32_t*>(base + layout.right);
+    black  = reinterpret_cast<const uint8_t*>(base + layout.black);
+    count  = uint32_t(header.count);
+    root   = header.root;
+    return true;
+}
+
+// Helper function to drop the mapping and the handles
+template <typename T>
+void MappedRedBlackTree<T>::unmap() {
+#ifdef _WIN32
+    if (base != nullptr)
+        UnmapViewOfFile(base);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+#else
+    if (base != nullptr)
+        munmap(const_cast<char*>(base), length);
+#endif
+}
+
+template <typename T>
+void MappedRedBlackTree<T>::close() {
+    unmap();
+    base = nullptr;
+    length = 0;
+    values = nullptr;
+    left = right = nullptr;
+    black = nullptr;
+    count = 0;
+    root = treeImageNil;
+}
+
+// Search for a value equal to val (one operator< per level, as in RedBlackTree)
+template <typename T>
+const T* MappedRedBlackTree<T>::search(const T& val) const {
+    uint32_t candidate = treeImageNil;
+    uint32_t node = root;
+    for (int depth = 0; node < count && depth < maxDepth; depth++) {
+        if (val < values[node])
+            node = left[node];
+        else {
+            candidate = node;
+            node = right[node];
+        }
+    }
+    return (candidate != treeImageNil && !(values[candidate] < val)) ? values + candidate : nullptr;
+}
+
+// Return the first value not less than val (nullptr if there is none)
+template <typename T>
+const T* MappedRedBlackTree<T>::lower_bound(const T& val) const {
+    uint32_t result = treeImageNil;
+    uint32_t node = root;
+    for (int depth = 0; node < count && depth < maxDepth; depth++) {
+        if (values[node] < val)
+            node = right[node];
+        else {
+            result = node;
+            node = left[node];
+        }
+    }
+    return result != treeImageNil ? values + result : nullptr;
+}
+
+// Call fn(data) for every value in [lo, hi). Values are stored in sorted order,
+// so after one lower_bound the range is a plain scan of the values section.
+template <typename T>
+template <typename Fn>
+void MappedRedBlackTree<T>::forEachInRange(const T& lo, const T& hi, Fn fn) const {
+    const T* first = lower_bound(lo);
+    if (first == nullptr)
+        return;
+    for (const T* value = first; value != end() && *value < hi; ++value)
+        fn(*value);
+}
@@ -0,0 +1,348 @@
+#pragma once
+#include <memory>
+#include "RedBlackTree.h"
+using namespace std;
+
+/*  --------------------------------------------------------------
+ Persistent Red-Black Tree: every version of the tree stays valid and readable.
+
+ Nodes are immutable and shared between versions. An update copies only the
+ O(log n) nodes on the path from the root to the changed position (plus the
+ few nodes the rebalancing touches) and shares every other node with the
+ previous version. Copying a PersistentRedBlackTree is therefore an O(1)
+ snapshot, and a write costs O(log n) new nodes instead of an O(n) copy.
+
+ Nodes are reference counted (shared_ptr): a node is freed as soon as the
+ last version using it is gone. Versions may be read from any number of
+ threads at once; a version is handed over to another thread by copying it
+ under whatever synchronization publishes it (e.g. std::atomic_store on a
+ shared_ptr holding the version).
+
+ Nodes have no parent pointer (a shared node has one parent per version).
+ Rebalancing follows Okasaki (insertion) and Kahrs (deletion): the fix-up
+ cases of RedBlackTree are rewritten as rebuilds of the nodes on the way
+ back up, instead of rotations and recoloring in place.
+*/
+
+// ------------------------ Node structure for the persistent tree ------------------------
+template <typename T>
+struct PersistentNode {
+    typedef shared_ptr<const PersistentNode<T>> Ptr;
+
+    T   data;
+    int color;
+    Ptr left;
+    Ptr right;
+
+    PersistentNode(int c, const Ptr& l, const T& val, const Ptr& r)
+        : data(val), color(c), left(l), right(r) {}
+};
+
+// Persistent Red-Black Tree class ================================================================
+template <typename T>
+class PersistentRedBlackTree {
+public:
+    typedef PersistentNode<T>        TreeNode;
+    typedef typename TreeNode::Ptr   NodePtr;
+
+private:
+    NodePtr root;
+    size_t  nodeCount;
+
+    // Private helper functions (each returns a new subtree, the old one is left untouched)
+    static NodePtr makeNode(int color, const NodePtr& l, const T& val, const NodePtr& r);
+    static bool    isRed(const NodePtr& node)   { return node && node->color == RED; }
+    static bool    isBlack(const NodePtr& node) { return node && node->color == BLACK; }
+    static NodePtr blacken(const NodePtr& node);
+    static NodePtr redden(const NodePtr& node);
+    static NodePtr balance(const NodePtr& l, const T& val, const NodePtr& r);
+    static NodePtr balanceLeft(const NodePtr& l, const T& val, const NodePtr& r);
+    static NodePtr balanceRight(const NodePtr& l, const T& val, const NodePtr& r);
+    static NodePtr append(const NodePtr& l, const NodePtr& r);
+    static NodePtr insertInto(const NodePtr& node, const T& val);
+    static NodePtr eraseFrom(const NodePtr& node, const T& val);
+    template <typename Fn>
+    static void    inorder(const TreeNode* node, Fn& fn);
+    template <typename Fn>
+    static void    inorderRange(const TreeNode* node, const T& lo, const T& hi, Fn& fn);
+
+public:
+    PersistentRedBlackTree() : nodeCount(0) {}
+
+    // Copies share every node: a copy is an O(1) snapshot of the current version
+    PersistentRedBlackTree(const PersistentRedBlackTree&) = default;
+    PersistentRedBlackTree& operator=(const PersistentRedBlackTree&) = default;
+    PersistentRedBlackTree  snapshot() const { return *this; }
+    void                    swap(PersistentRedBlackTree& other) noexcept;
+
+    // Updates - replace this version by a new one; snapshots taken before are not affected
+    void            insert(const T& val);
+    bool            erase(const T& val);
+    void            clear() { root.reset(); nodeCount = 0; }
+
+    // Updates returning the new version and leaving this one as it is
+    PersistentRedBlackTree inserted(const T& val) const;
+    PersistentRedBlackTree erased(const T& val) const;
+
+    // Queries - returned nodes stay valid as long as a version holding them exists
+    size_t          size() const  { return nodeCount; }
+    bool            empty() const { return nodeCount == 0; }
+    const TreeNode* search(const T& val) const;
+    bool            contains(const T& val) const { return search(val) != nullptr; }
+    const TreeNode* lower_bound(const T& val) const;
+    const TreeNode* getRoot() const { return root.get(); }
+    template <typename Fn>
+    void            forEach(Fn fn) const;
+    template <typename Fn>
+    void            forEachInRange(const T& lo, const T& hi, Fn fn) const;
+};
+// ------------------------------------------------------------------------------------------------
+
+template <typename T>
+void PersistentRedBlackTree<T>::swap(PersistentRedBlackTree& other) noexcept {
+    root.swap(other.root);
+    std::swap(nodeCount, other.nodeCount);
+}
+
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr
+PersistentRedBlackTree<T>::makeNode(int color, const NodePtr& l, const T& val, const NodePtr& r) {
+    return make_shared<const TreeNode>(color, l, val, r);
+}
+
+// Copy of a node colored BLACK (the node itself when it already is)
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr PersistentRedBlackTree<T>::blacken(const NodePtr& node) {
+    if (node == nullptr || node->color == BLACK)
+        return node;
+    return makeNode(BLACK, node->left, node->data, node->right);
+}
+
+// Copy of a BLACK node colored RED (only used on BLACK nodes by the deletion)
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr PersistentRedBlackTree<T>::redden(const NodePtr& node) {
+    return makeNode(RED, node->left, node->data, node->right);
+}
+
+// Build the node (l, val, r) and repair a red-red violation in one of its children.
+// The four shapes of a RED child with a RED grandchild (the cases that fixInsertion
+// handles with rotations) all become a RED node with two BLACK children.
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr
+PersistentRedBlackTree<T>::balance(const NodePtr& l, const T& val, const NodePtr& r) {
+    // Both children RED: color flip
+    if (isRed(l) && isRed(r))
+        return makeNode(RED, blacken(l), val, blacken(r));
+
+    if (isRed(l)) {
+        // Left-left: single rotation to the right
+        if (isRed(l->left))
+            return makeNode(RED, blacken(l->left), l->data, makeNode(BLACK, l->right, val, r));
+        // Left-right: double rotation
+        if (isRed(l->right))
+            return makeNode(RED, makeNode(BLACK, l->left, l->data, l->right->left), l->right->data,
+                            makeNode(BLACK, l->right->right, val, r));
+    }
+    if (isRed(r)) {
+        // Right-right: single rotation to the left
+        if (isRed(r->right))
+            return makeNode(RED, makeNode(BLACK, l, val, r->left), r->data, blacken(r->right));
+        // Right-left: double rotation
+        if (isRed(r->left))
+            return makeNode(RED, makeNode(BLACK, l, val, r->left->left), r->left->data,
+                            makeNode(BLACK, r->left->right, r->data, r->right));
+    }
+    return makeNode(BLACK, l, val, r);
+}
+
+// Build the node (l, val, r) where l has lost one level of black height
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr
+PersistentRedBlackTree<T>::balanceLeft(const NodePtr& l, const T& val, const NodePtr& r) {
+    if (isRed(l))
+        return makeNode(RED, blacken(l), val, r);
+    if (isBlack(r))
+        return balance(l, val, redden(r));
+    // r is RED with a BLACK left child
+    return makeNode(RED, makeNode(BLACK, l, val, r->left->left), r->left->data,
+                    balance(r->left->right, r->data, redden(r->right)));
+}
+
+// Build the node (l, val, r) where r has lost one level of black height
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr
+PersistentRedBlackTree<T>::balanceRight(const NodePtr& l, const T& val, const NodePtr& r) {
+    if (isRed(r))
+        return makeNode(RED, l, val, blacken(r));
+    if (isBlack(l))
+        return balance(redden(l), val, r);
+    // l is RED with a BLACK right child
+    return makeNode(RED, balance(redden(l->left), l->data, l->right->left), l->right->data,
+                    makeNode(BLACK, l->right->right, val, r));
+}
+
+// Join two subtrees of equal black height, every value of l before every value of r
+// (replaces the node removed by the deletion)
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr
+PersistentRedBlackTree<T>::append(const NodePtr& l, const NodePtr& r) {
+    if (l == nullptr)
+        return r;
+    if (r == nullptr)
+        return l;
+
+    if (isRed(l) && isRed(r)) {
+        NodePtr middle = append(l->right, r->left);
+        if (isRed(middle))
+            return makeNode(RED, makeNode(RED, l->left, l->data, middle->left), middle->data,
+                            makeNode(RED, middle->right, r->data, r->right));
+        return makeNode(RED, l->left, l->data, makeNode(RED, middle, r->data, r->right));
+    }
+    if (isBlack(l) && isBlack(r)) {
+        NodePtr middle = append(l->right, r->left);
+        if (isRed(middle))
+            return makeNode(RED, makeNode(BLACK, l->left, l->data, middle->left), middle->data,
+                            makeNode(BLACK, middle->right, r->data, r->right));
+        return balanceLeft(l->left, l->data, makeNode(BLACK, middle, r->data, r->right));
+    }
+    if (isRed(r))
+        return makeNode(RED, append(l, r->left), r->data, r->right);
+    return makeNode(RED, l->left, l->data, append(l->right, r));
+}
+
+// Helper function to insert val below node (equal keys go to the right)
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr
+PersistentRedBlackTree<T>::insertInto(const NodePtr& node, const T& val) {
+    if (node == nullptr)
+        return makeNode(RED, nullptr, val, nullptr);
+
+    if (val < node->data) {
+        if (node->color == BLACK)
+            return balance(insertInto(node->left, val), node->data, node->right);
+        return makeNode(RED, insertInto(node->left, val), node->data, node->right);
+    }
+    if (node->color == BLACK)
+        return balance(node->left, node->data, insertInto(node->right, val));
+    return makeNode(RED, node->left, node->data, insertInto(node->right, val));
+}
+
+// Helper function to erase one copy of val below node (val must be present)
+template <typename T>
+typename PersistentRedBlackTree<T>::NodePtr
+PersistentRedBlackTree<T>::eraseFrom(const NodePtr& node, const T& val) {
+    if (val < node->data) {
+        if (isBlack(node->left))
+            return balanceLeft(eraseFrom(node->left, val), node->data, node->right);
+        return makeNode(RED, eraseFrom(node->left, val), node->data, node->right);
+    }
+    if (node->data < val) {
+        if (isBlack(node->right))
+            return balanceRight(node->left, node->data, eraseFrom(node->right, val));
+        return makeNode(RED, node->left, node->data, eraseFrom(node->right, val));
+    }
+    return append(node->left, node->right);
+}
+
+// Insert val - copies the path to the new leaf, the root is always BLACK
+template <typename T>
+void PersistentRedBlackTree<T>::insert(const T& val) {
+    root = blacken(insertInto(root, val));
+    nodeCount++;
+}
+
+// Erase one copy of val. Returns false (and keeps the version) if val is not in the tree.
+template <typename T>
+bool PersistentRedBlackTree<T>::erase(const T& val) {
+    if (search(val) == nullptr)
+        return false;
+    root = blacken(eraseFrom(root, val));
+    nodeCount--;
+    return true;
+}
+
+template <typename T>
+PersistentRedBlackTree<T> PersistentRedBlackTree<T>::inserted(const T& val) const {
+    PersistentRedBlackTree<T> version(*this);
+    version.insert(val);
+    return version;
+}
+
+template <typename T>
+PersistentRedBlackTree<T> PersistentRedBlackTree<T>::erased(const T& val) const {
+    PersistentRedBlackTree<T> version(*this);
+    version.erase(val);
+    return version;
+}
+
+// Search for a node with data equal to val (one operator< per level, as in RedBlackTree)
+template <typename T>
+const PersistentNode<T>* PersistentRedBlackTree<T>::search(const T& val) const {
+    const TreeNode* node = root.get();
+    const TreeNode* candidate = nullptr;
+    while (node != nullptr) {
+        if (val < node->data)
+            node = node->left.get();
+        else {
+            candidate = node;
+            node = node->right.get();
+        }
+    }
+    // candidate is the last node with data <= val
+    return (candidate != nullptr && !(candidate->data < val)) ? candidate : nullptr;
+}
+
+// Return the first node with data not less than val (nullptr if there is none)
+template <typename T>
+const PersistentNode<T>* PersistentRedBlackTree<T>::lower_bound(const T& val) const {
+    const TreeNode* node = root.get();
+    const TreeNode* result = nullptr;
+    while (node != nullptr) {
+        if (node->data < val)
+            node = node->right.get();
+        else {
+            result = node;
+            node = node->left.get();
+        }
+    }
+    return result;
+}
+
+// Call fn(data) for every value in sorted order
+template <typename T>
+template <typename Fn>
+void PersistentRedBlackTree<T>::forEach(Fn fn) const {
+    inorder(root.get(), fn);
+}
+
+// Call fn(data) for every value in [lo, hi), in sorted order
+template <typename T>
+template <typename Fn>
+void PersistentRedBlackTree<T>::forEachInRange(const T& lo, const T& hi, Fn fn) const {
+    inorderRange(root.get(), lo, hi, fn);
+}
+
+// Helper functions for the traversals (the recursion depth is the tree height)
+template <typename T>
+template <typename Fn>
+void PersistentRedBlackTree<T>::inorder(const TreeNode* node, Fn& fn) {
+    if (node != nullptr) {
+        inorder(node->left.get(), fn);
+        fn(node->data);
+        inorder(node->right.get(), fn);
+    }
+}
+
+template <typename T>
+template <typename Fn>
+void PersistentRedBlackTree<T>::inorderRange(const TreeNode* node, const T& lo, const T& hi, Fn& fn) {
+    if (node == nullptr)
+        return;
+    // Values equal to data may be on both sides, so only skip a side that is surely out of range
+    if (!(node->data < lo))
+        inorderRange(node->left.get(), lo, hi, fn);
+    if (!(node->data < lo) && node->data < hi)
+        fn(node->data);
+    if (node->data < hi)
+        inorderRange(node->right.get(), lo, hi, fn);
+}
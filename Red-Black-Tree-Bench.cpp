@@ -0,0 +1,326 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "RedBlackTree.h"
+using namespace std;
+
+/*  --------------------------------------------------------------
+ Benchmark harness for the Red-Black Tree (RBT) in RedBlackTree.h
+
+ For every key distribution and every size 10^minExp .. 10^maxExp it runs
+     insert  - n inserts into an empty container
+     search  - n lookups drawn from the same distribution
+     erase   - one erase per key inserted
+     mixed   - n operations, 50% insert / 50% search, on a fresh container
+ on RedBlackTree, std::multiset (same duplicate semantics), std::set and
+ std::map (unique keys, the map also stores a value per key), and reports
+ throughput plus latency percentiles as CSV (default) or JSON.
+
+ Usage: Red-Black-Tree-Bench [--min-exp 3] [--max-exp 6] [--json] [--out file]
+*/
+
+typedef long long Key;
+typedef chrono::steady_clock Clock;
+
+// Every sampleStride-th operation is timed on its own for the latency percentiles
+const size_t sampleStride = 64;
+
+// ------------------------ Key distributions ------------------------
+enum Workload { Sequential, Random, Zipfian, Duplicates };
+
+const char* workloadName(Workload w) {
+    static const char* const names[] = { "sequential", "random", "zipfian", "duplicates" };
+    return names[w];
+}
+
+// Zipfian ranks in [0, n) with skew theta (Gray et al., "Quickly generating
+// billion-record synthetic databases"): O(n) setup, O(1) per key
+class ZipfGenerator {
+private:
+    double n, theta, alpha, zetan, eta;
+
+    static double zeta(size_t count, double theta) {
+        double sum = 0;
+        for (size_t i = 1; i <= count; i++)
+            sum += 1.0 / pow(double(i), theta);
+        return sum;
+    }
+
+public:
+    ZipfGenerator(size_t count, double skew = 0.99) : n(double(count)), theta(skew) {
+        alpha = 1.0 / (1.0 - theta);
+        zetan = zeta(count, theta);
+        eta   = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta(2, theta) / zetan);
+    }
+
+    size_t next(mt19937_64& rng) {
+        double u  = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan;
+        if (uz < 1.0)
+            return 0;
+        if (uz < 1.0 + pow(0.5, theta))
+            return 1;
+        size_t rank = size_t(n * pow(eta * u - eta + 1.0, alpha));
+        return rank < size_t(n) ? rank : size_t(n) - 1;
+    }
+};
+
+// Scatter ranks over the key space so the hot keys are not neighbours in the tree
+Key scramble(size_t rank) {
+    return Key((uint64_t(rank) * 0x9E3779B97F4A7C15ull) >> 1);
+}
+
+// Generate count keys of the given distribution (the key space has n keys)
+vector<Key> makeKeys(Workload w, size_t n, size_t count, uint64_t seed) {
+    mt19937_64  rng(seed);
+    vector<Key> keys(count);
+
+    if (w == Sequential) {
+        for (size_t i = 0; i < count; i++)
+            keys[i] = Key(i % n);
+    }
+    else if (w == Random) {
+        uniform_int_distribution<Key> pick(0, Key(n) * 4);
+        for (size_t i = 0; i < count; i++)
+            keys[i] = pick(rng);
+    }
+    else if (w == Zipfian) {
+        ZipfGenerator zipf(n);
+        for (size_t i = 0; i < count; i++)
+            keys[i] = scramble(zipf.next(rng));
+    }
+    else {
+        // Duplicate heavy: about 16 copies of every key
+        uniform_int_distribution<Key> pick(0, Key(n / 16 + 1));
+        for (size_t i = 0; i < count; i++)
+            keys[i] = pick(rng);
+    }
+    return keys;
+}
+
+// ------------------------ Container adapters ------------------------
+//  insert / search / erase with the same meaning for every container:
+//  search reports whether the key is present, erase removes a single copy.
+struct TreeAdapter {
+    static const char* name() { return "RedBlackTree"; }
+    RedBlackTree<Key> c;
+    void insert(Key k)       { c.insert(k); }
+    bool search(Key k) const { return c.search(k) != nullptr; }
+    void erase(Key k)        { c.erase(k); }
+};
+
+struct MultisetAdapter {
+    static const char* name() { return "std::multiset"; }
+    multiset<Key> c;
+    void insert(Key k)       { c.insert(k); }
+    bool search(Key k) const { return c.find(k) != c.end(); }
+    void erase(Key k) {
+        multiset<Key>::iterator it = c.find(k);
+        if (it != c.end())
+            c.erase(it);
+    }
+};
+
+struct SetAdapter {
+    static const char* name() { return "std::set"; }
+    set<Key> c;
+    void insert(Key k)       { c.insert(k); }
+    bool search(Key k) const { return c.find(k) != c.end(); }
+    void erase(Key k)        { c.erase(k); }
+};
+
+struct MapAdapter {
+    static const char* name() { return "std::map"; }
+    map<Key, Key> c;
+    void insert(Key k)       { c.insert(make_pair(k, k)); }
+    bool search(Key k) const { return c.find(k) != c.end(); }
+    void erase(Key k)        { c.erase(k); }
+};
+
+// ------------------------ Measurements ------------------------
+struct Result {
+    const char* container;
+    const char* workload;
+    size_t      n;
+    const char* op;
+    size_t      ops;
+    double      seconds;
+    double      p50, p90, p99, p999;    // nanoseconds per operation
+};
+
+// Keeps the compiler from dropping the searches: each phase counts its hits
+// in a plain variable and stores the total here once
+volatile size_t sink = 0;
+
+// Run op(i) for i in [0, count): the whole loop gives the throughput and every
+// sampleStride-th operation, timed separately, gives the latency distribution
+template <typename Op>
+Result measure(size_t count, Op op) {
+    vector<double> samples;
+    samples.reserve(count / sampleStride + 1);
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+        if (i % sampleStride == 0) {
+            Clock::time_point t0 = Clock::now();
+            op(i);
+            samples.push_back(double(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - t0).count()));
+        }
+        else
+            op(i);
+    }
+    Clock::time_point stop = Clock::now();
+
+    Result r = Result();
+    r.ops = count;
+    r.seconds = chrono::duration<double>(stop - start).count();
+    sort(samples.begin(), samples.end());
+    if (!samples.empty()) {
+        r.p50  = samples[size_t(0.50  * (samples.size() - 1))];
+        r.p90  = samples[size_t(0.90  * (samples.size() - 1))];
+        r.p99  = samples[size_t(0.99  * (samples.size() - 1))];
+        r.p999 = samples[size_t(0.999 * (samples.size() - 1))];
+    }
+    return r;
+}
+
+// Run the four phases on one container type
+template <typename Adapter>
+void runContainer(Workload w, size_t n, const vector<Key>& inserts, const vector<Key>& probes,
+                  vector<Result>& results) {
+    Result r;
+    size_t found = 0;
+    {
+        Adapter a;
+        r = measure(n, [&](size_t i) { a.insert(inserts[i]); });
+        r.op = "insert";
+        results.push_back(r);
+
+        r = measure(n, [&](size_t i) { found += a.search(probes[i]); });
+        r.op = "search";
+        results.push_back(r);
+
+        r = measure(n, [&](size_t i) { a.erase(inserts[i]); });
+        r.op = "erase";
+        results.push_back(r);
+    }
+    {
+        Adapter a;
+        r = measure(n, [&](size_t i) {
+            if (i & 1)
+                found += a.search(probes[i]);
+            else
+                a.insert(inserts[i]);
+        });
+        r.op = "mixed";
+        results.push_back(r);
+    }
+    sink = sink + found;
+
+    for (size_t i = results.size() - 4; i < results.size(); i++) {
+        results[i].container = Adapter::name();
+        results[i].workload  = workloadName(w);
+        results[i].n         = n;
+    }
+}
+
+// ------------------------ Output ------------------------
+void writeCsv(ostream& out, const vector<Result>& results) {
+    out << "container,workload,n,op,ops,seconds,mops_per_sec,p50_ns,p90_ns,p99_ns,p999_ns\n";
+    for (const Result& r : results)
+        out << r.container << ',' << r.workload << ',' << r.n << ',' << r.op << ','
+            << r.ops << ',' << r.seconds << ',' << (r.ops / r.seconds) / 1e6 << ','
+            << r.p50 << ',' << r.p90 << ',' << r.p99 << ',' << r.p999 << '\n';
+}
+
+void writeJson(ostream& out, const vector<Result>& results) {
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "  {\"container\": \"" << r.container << "\", \"workload\": \"" << r.workload
+            << "\", \"n\": " << r.n << ", \"op\": \"" << r.op << "\", \"ops\": " << r.ops
+            << ", \"seconds\": " << r.seconds << ", \"mops_per_sec\": " << (r.ops / r.seconds) / 1e6
+            << ", \"p50_ns\": " << r.p50 << ", \"p90_ns\": " << r.p90
+            << ", \"p99_ns\": " << r.p99 << ", \"p999_ns\": " << r.p999 << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+}
+
+// ==================== Main function ===============================================================
+
+int main(int argc, char* argv[]) {
+    int    minExp = 3;
+    int    maxExp = 6;
+    bool   json = false;
+    string outPath;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-exp") == 0 && i + 1 < argc)
+            minExp = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-exp") == 0 && i + 1 < argc)
+            maxExp = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else {
+            cerr << "Usage: " << argv[0] << " [--min-exp 3] [--max-exp 6] [--json] [--out file]" << endl;
+            return 1;
+        }
+    }
+    if (minExp < 1 || maxExp > 8 || minExp > maxExp) {
+        cerr << " Sizes must satisfy 1 <= min-exp <= max-exp <= 8" << endl;
+        return 1;
+    }
+
+    // Open the output first, so a bad path fails before the runs instead of after
+    ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath.c_str());
+        if (!file) {
+            cerr << " Cannot write to " << outPath << endl;
+            return 1;
+        }
+    }
+
+    vector<Result> results;
+    for (int e = minExp; e <= maxExp; e++) {
+        size_t n = 1;
+        for (int i = 0; i < e; i++)
+            n *= 10;
+
+        for (int w = Sequential; w <= Duplicates; w++) {
+            Workload    workload = Workload(w);
+            vector<Key> inserts = makeKeys(workload, n, n, 1);
+            vector<Key> probes  = makeKeys(workload, n, n, 2);
+
+            cerr << " " << workloadName(workload) << " n=" << n << endl;
+            runContainer<TreeAdapter>(workload, n, inserts, probes, results);
+            runContainer<MultisetAdapter>(workload, n, inserts, probes, results);
+            runContainer<SetAdapter>(workload, n, inserts, probes, results);
+            runContainer<MapAdapter>(workload, n, inserts, probes, results);
+        }
+    }
+
+    ostream& out = outPath.empty() ? cout : file;
+    if (json)
+        writeJson(out, results);
+    else
+        writeCsv(out, results);
+    out.flush();
+    if (!out) {
+        cerr << " Writing the results failed" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include <functional>
+#include <utility>
+#include "RedBlackTree.h"
+using namespace std;
+
+/*  --------------------------------------------------------------
+ Key/value map on the Red-Black Tree: RedBlackMap<K, V, Compare>.
+
+ The entries live in a RedBlackTree with the UniqueKeys policy, so inserts,
+ erases and rebalancing are the ones of RedBlackTree.h. Entries are ordered
+ by their key with Compare.
+
+ Lookups walk the nodes with Compare directly. With a transparent comparator
+ (one that defines is_transparent, like the default less<>), find(), erase(),
+ lower_bound() ... accept any key type Compare can compare with K, e.g. a
+ const char* or a string_view for string keys, and no temporary K is built.
+ With any other comparator the lookup key is converted to K first, as in std::map.
+
+ Compare is default constructed where it is needed (the tree orders its values
+ with operator<), so it has to be stateless.
+*/
+
+// Entry of a RedBlackMap: the key and the mapped value, ordered by key
+template <typename K, typename V, typename Compare>
+struct MapEntry {
+    K first;
+    V second;
+
+    template <typename KK, typename VV>
+    MapEntry(KK&& key, VV&& value) : first(std::forward<KK>(key)), second(std::forward<VV>(value)) {}
+
+    bool operator<(const MapEntry& other) const { return Compare()(first, other.first); }
+};
+
+// Red-Black Map class ============================================================================
+template <typename K, typename V, typename Compare = less<>>
+class RedBlackMap {
+public:
+    typedef MapEntry<K, V, Compare>                             Entry;
+    typedef RedBlackTree<Entry, NoAugment, NoTrace, UniqueKeys> Tree;
+    typedef typename Tree::TreeNode                             TreeNode;
+
+    // Bidirectional iterator over the entries in key order. The mapped value can
+    // be changed through it; the key must not be.
+    class iterator {
+    public:
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef Entry                      value_type;
+        typedef ptrdiff_t                  difference_type;
+        typedef Entry*                     pointer;
+        typedef Entry&                     reference;
+
+        iterator() {}
+        explicit iterator(typename Tree::iterator it) : current(it) {}
+
+        reference operator*() const  { return current.node()->data; }
+        pointer   operator->() const { return &current.node()->data; }
+        TreeNode* node() const       { return current.node(); }
+
+        iterator& operator++() { ++current; return *this; }
+        iterator  operator++(int) { iterator old = *this; ++current; return old; }
+        iterator& operator--() { --current; return *this; }
+        iterator  operator--(int) { iterator old = *this; --current; return old; }
+
+        bool operator==(const iterator& other) const { return current == other.current; }
+        bool operator!=(const iterator& other) const { return current != other.current; }
+
+    private:
+        typename Tree::iterator current;
+    };
+    typedef iterator const_iterator;
+
+private:
+    Tree tree;
+
+    template <typename Key>
+    TreeNode* lowerBoundNode(const Key& key) const;
+    template <typename Key>
+    TreeNode* upperBoundNode(const Key& key) const;
+    template <typename Key>
+    TreeNode* findNode(const Key& key) const;
+    iterator  toIterator(TreeNode* node) const { return iterator(typename Tree::iterator(&tree, node)); }
+
+public:
+    RedBlackMap() {}
+    RedBlackMap(RedBlackMap&&) = default;
+    RedBlackMap& operator=(RedBlackMap&&) = default;
+
+    // Public interface
+    bool      insert(K key, V value);
+    bool      insertOrAssign(K key, V value);
+    V&        operator[](const K& key);
+    void      clear()       { tree.clear(); }
+    size_t    size() const  { return tree.size(); }
+    bool      empty() const { return tree.empty(); }
+
+    // Lookups by K, then by any key type when Compare is transparent
+    iterator  find(const K& key) const        { return toIterator(findNode(key)); }
+    bool      contains(const K& key) const    { return findNode(key) != nullptr; }
+    size_t    count(const K& key) const       { return findNode(key) != nullptr ? 1 : 0; }
+    bool      erase(const K& key);
+    iterator  lower_bound(const K& key) const { return toIterator(lowerBoundNode(key)); }
+    iterator  upper_bound(const K& key) const { return toIterator(upperBoundNode(key)); }
+
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator  find(const Key& key) const        { return toIterator(findNode(key)); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    bool      contains(const Key& key) const    { return findNode(key) != nullptr; }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    size_t    count(const Key& key) const       { return findNode(key) != nullptr ? 1 : 0; }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    bool      erase(const Key& key);
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator  lower_bound(const Key& key) const { return toIterator(lowerBoundNode(key)); }
+    template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+    iterator  upper_bound(const Key& key) const { return toIterator(upperBoundNode(key)); }
+
+    // Call fn(entry) for every entry with a key in [lo, hi)
+    template <typename Key, typename Fn>
+    void      forEachInRange(const Key& lo, const Key& hi, Fn fn) const;
+
+    // Iteration in key order
+    iterator  begin() const { return iterator(tree.begin()); }
+    iterator  end() const   { return iterator(tree.end()); }
+
+    // The underlying tree (e.g. for print() or stats())
+    const Tree& getTree() const { return tree; }
+};
+// ------------------------------------------------------------------------------------------------
+
+// Helper function for the lookups: the first node whose key is not less than key
+template <typename K, typename V, typename Compare>
+template <typename Key>
+typename RedBlackMap<K, V, Compare>::TreeNode*
+RedBlackMap<K, V, Compare>::lowerBoundNode(const Key& key) const {
+    Compare   less;
+    TreeNode* result = nullptr;
+    TreeNode* node = tree.getRoot();
+    while (node != nullptr) {
+        if (less(node->data.first, key))
+            node = node->right;
+        else {
+            result = node;
+            node = node->left;
+        }
+    }
+    return result;
+}
+
+// Helper function for the lookups: the first node whose key is greater than key
+template <typename K, typename V, typename Compare>
+template <typename Key>
+typename RedBlackMap<K, V, Compare>::TreeNode*
+RedBlackMap<K, V, Compare>::upperBoundNode(const Key& key) const {
+    Compare   less;
+    TreeNode* result = nullptr;
+    TreeNode* node = tree.getRoot();
+    while (node != nullptr) {
+        if (less(key, node->data.first)) {
+            result = node;
+            node = node->left;
+        }
+        else
+            node = node->right;
+    }
+    return result;
+}
+
+// Helper function for the lookups: the node of key (nullptr if there is none)
+template <typename K, typename V, typename Compare>
+template <typename Key>
+typename RedBlackMap<K, V, Compare>::TreeNode*
+RedBlackMap<K, V, Compare>::findNode(const Key& key) const {
+    TreeNode* node = lowerBoundNode(key);
+    return (node != nullptr && !Compare()(key, node->data.first)) ? node : nullptr;
+}
+
+// Add key with value. Returns false (and keeps the old value) if key is already in the map.
+template <typename K, typename V, typename Compare>
+bool RedBlackMap<K, V, Compare>::insert(K key, V value) {
+    return tree.emplace(std::move(key), std::move(value));
+}
+
+// Add key with value, or replace the value of key. Returns true if key is new.
+template <typename K, typename V, typename Compare>
+bool RedBlackMap<K, V, Compare>::insertOrAssign(K key, V value) {
+    TreeNode* node = findNode(key);
+    if (node != nullptr) {
+        node->data.second = std::move(value);
+        return false;
+    }
+    return tree.emplace(std::move(key), std::move(value));
+}
+
+// Value of key, added with a default constructed V if key is not in the map yet
+template <typename K, typename V, typename Compare>
+V& RedBlackMap<K, V, Compare>::operator[](const K& key) {
+    TreeNode* node = findNode(key);
+    if (node == nullptr)
+        node = tree.insert(tree.end(), Entry(key, V())).node();
+    return node->data.second;
+}
+
+// Remove key. Returns false when key is not in the map.
+template <typename K, typename V, typename Compare>
+bool RedBlackMap<K, V, Compare>::erase(const K& key) {
+    TreeNode* node = findNode(key);
+    if (node == nullptr)
+        return false;
+    tree.erase(node);
+    return true;
+}
+
+template <typename K, typename V, typename Compare>
+template <typename Key, typename C, typename>
+bool RedBlackMap<K, V, Compare>::erase(const Key& key) {
+    TreeNode* node = findNode(key);
+    if (node == nullptr)
+        return false;
+    tree.erase(node);
+    return true;
+}
+
+template <typename K, typename V, typename Compare>
+template <typename Key, typename Fn>
+void RedBlackMap<K, V, Compare>::forEachInRange(const Key& lo, const Key& hi, Fn fn) const {
+    Compare less;
+    for (iterator it = toIterator(lowerBoundNode(lo)); it != end() && less(it->first, hi); ++it)
+        fn(*it);
+}
@@ -0,0 +1,3045 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <future>
+#include <thread>
+#include <system_error>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+using namespace std;
+
+/*  --------------------------------------------------------------
+ This is a partial implementation of a Red-Black Tree (RBT).
+ This version includes insertion, deletion and search functions.
+ Refer to the following resources for more details:
+ "Introduction to Algorithms" by Cormen  ISBN-13: 978-0262033848
+
+ For a visualization of RBT operations, visit the following link
+ https://www.cs.usfca.edu/~galles/visualization/RedBlack.html
+*/
+
+
+
+
+//Define the color of the nodes
+const int RED   = 0;
+const int BLACK = 1;
+// Default node layout: the color is kept in the low bit of the parent pointer
+// (compact nodes, ON by default: 32 bytes for Node<int> instead of 40 on a
+// 64-bit build). Node and RedBlackTree take the layout as their last template
+// parameter, so a tree can ask for the plain layout (separate color field) with
+// RedBlackTree<T, Augment, Trace, Duplicates, false>.
+const bool compactNodes = true;
+
+// Ask the CPU to start loading the cache line holding addr (no-op where unsupported)
+#if defined(__GNUC__) || defined(__clang__)
+#define RBT_PREFETCH(addr) __builtin_prefetch(addr)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#define RBT_PREFETCH(addr) _mm_prefetch(reinterpret_cast<const char*>(addr), _MM_HINT_T0)
+#else
+#define RBT_PREFETCH(addr) ((void)0)
+#endif
+
+// ------------------------ Parent link and color of a node ------------------------
+//  Plain layout: the parent pointer and the color are two separate fields.
+template <typename NodeT, bool Compact>
+class ParentAndColor {
+private:
+    NodeT* parent;
+    int    color;
+
+public:
+    ParentAndColor(NodeT* p, int c) : parent(p), color(c) {}
+
+    NodeT* getParent() const      { return parent; }
+    void   setParent(NodeT* p)    { parent = p; }
+    int    getColor() const       { return color; }
+    void   setColor(int c)        { color = c; }
+};
+
+//  Compact layout: nodes are at least pointer aligned, so the low bit of the
+//  parent address is always 0 and is free to hold the color (RED = 0, BLACK = 1).
+template <typename NodeT>
+class ParentAndColor<NodeT, true> {
+private:
+    uintptr_t bits;
+
+public:
+    ParentAndColor(NodeT* p, int c) : bits(reinterpret_cast<uintptr_t>(p) | uintptr_t(c)) {}
+
+    NodeT* getParent() const      { return reinterpret_cast<NodeT*>(bits & ~uintptr_t(1)); }
+    void   setParent(NodeT* p)    { bits = reinterpret_cast<uintptr_t>(p) | (bits & 1); }
+    int    getColor() const       { return int(bits & 1); }
+    void   setColor(int c)        { bits = (bits & ~uintptr_t(1)) | uintptr_t(c); }
+};
+
+// ------------------------ Node augmentations ------------------------
+//  An augmentation adds data to every node (Node<T, Augment> derives from it) and
+//  recomputes that data from the node's children in update(). The tree calls update()
+//  bottom-up on every node whose subtree changes, including both nodes of a rotation.
+
+// No augmentation: nodes carry no extra data
+struct NoAugment {
+    static const bool enabled = false;
+
+    template <typename NodeT>
+    static void update(NodeT*) {}
+};
+
+// Order statistics: every node keeps the number of nodes in its subtree
+struct SubtreeSize {
+    static const bool enabled = true;
+    size_t size = 1;
+
+    template <typename NodeT>
+    static size_t sizeOf(const NodeT* pn) { return pn == nullptr ? 0 : pn->size; }
+
+    template <typename NodeT>
+    static void update(NodeT* pn) { pn->size = 1 + sizeOf(pn->left) + sizeOf(pn->right); }
+};
+
+// Closed interval [low, high] of endpoints of type E, ordered by low end, then high end
+template <typename E>
+struct Interval {
+    E low;
+    E high;
+
+    Interval() : low(), high() {}
+    Interval(const E& l, const E& h) : low(l), high(h) {}
+
+    bool operator<(const Interval& other) const {
+        return low < other.low || (!(other.low < low) && high < other.high);
+    }
+};
+
+// Interval tree: every node keeps the largest high end in its subtree, for T with
+// low and high members (e.g. Interval<E>). See overlaps() and findOverlap().
+struct IntervalMaxTag {};
+
+template <typename E>
+struct IntervalMax : public IntervalMaxTag {
+    static const bool enabled = true;
+    E maxHigh = E();
+
+    template <typename NodeT>
+    static void update(NodeT* pn) {
+        pn->maxHigh = pn->data.high;
+        if (pn->left != nullptr && pn->maxHigh < pn->left->maxHigh)
+            pn->maxHigh = pn->left->maxHigh;
+        if (pn->right != nullptr && pn->maxHigh < pn->right->maxHigh)
+            pn->maxHigh = pn->right->maxHigh;
+    }
+};
+
+// ------------------------ Duplicate key policies ------------------------
+//  What the tree does with a value whose key is already in the tree:
+//      MultiKeys    - a node of its own, to the right of the equal ones (default)
+//      UniqueKeys   - rejected, the tree keeps the value it already has
+//      CountedKeys  - counted in the node of the key, the value itself is dropped
+//      BucketedKeys - kept in a bucket (a vector allocated on first use) of the node of the key
+//  With the folding policies (all but MultiKeys) every key has exactly one node:
+//  size() and iteration count keys, count(val) is the number of copies of a key.
+//  A policy adds its data to the nodes as a layer over the augmentation:
+//  the nodes derive from Policy::NodeBase<T, Augment>.
+struct MultiKeys {
+    static const bool foldsEqual  = false;  // equal keys share one node
+    static const bool extraCopies = false;  // a node can stand for several copies
+
+    template <typename T, typename Augment>
+    using NodeBase = Augment;
+
+    // Fold the copies held by node from into node into (from is destroyed afterwards)
+    template <typename NodeT>
+    static void   absorb(NodeT*, NodeT*) {}
+    // Fold one more copy of the key of node
+    template <typename NodeT, typename V>
+    static void   absorbValue(NodeT*, V&&) {}
+    // Number of copies a node stands for
+    template <typename NodeT>
+    static size_t copies(const NodeT*) { return 1; }
+    // Remove one copy; returns true when the node stands for none any more
+    template <typename NodeT>
+    static bool   dropOne(NodeT*) { return true; }
+    // Give a copy of node src (see RedBlackTree::clone()) the copies held by src
+    template <typename NodeT>
+    static void   copySlot(NodeT*, const NodeT*) {}
+};
+
+struct UniqueKeys : public MultiKeys {
+    static const bool foldsEqual = true;
+};
+
+// Node data of CountedKeys: the number of copies of the key
+template <typename Augment>
+struct CountedSlot : public Augment {
+    size_t count = 1;
+};
+
+struct CountedKeys {
+    static const bool foldsEqual  = true;
+    static const bool extraCopies = true;
+
+    template <typename T, typename Augment>
+    using NodeBase = CountedSlot<Augment>;
+
+    template <typename NodeT>
+    static void   absorb(NodeT* into, NodeT* from) { into->count += from->count; }
+    template <typename NodeT, typename V>
+    static void   absorbValue(NodeT* into, V&&) { into->count++; }
+    template <typename NodeT>
+    static size_t copies(const NodeT* pn) { return pn->count; }
+    template <typename NodeT>
+    static bool   dropOne(NodeT* pn) { return --pn->count == 0; }
+    template <typename NodeT>
+    static void   copySlot(NodeT* dst, const NodeT* src) { dst->count = src->count; }
+};
+
+// Node data of BucketedKeys: the copies after the first one (nullptr while there are none)
+template <typename T, typename Augment>
+struct BucketSlot : public Augment {
+    unique_ptr<vector<T>> bucket;
+};
+
+struct BucketedKeys {
+    static const bool foldsEqual  = true;
+    static const bool extraCopies = true;
+
+    template <typename T, typename Augment>
+    using NodeBase = BucketSlot<T, Augment>;
+
+    template <typename NodeT>
+    static void absorb(NodeT* into, NodeT* from) {
+        absorbValue(into, std::move(from->data));
+        if (from->bucket)
+            for (auto& val : *from->bucket)
+                into->bucket->push_back(std::move(val));
+    }
+    template <typename NodeT, typename V>
+    static void absorbValue(NodeT* into, V&& val) {
+        if (!into->bucket)
+            into->bucket.reset(new vector<typename remove_reference<decltype(into->data)>::type>());
+        into->bucket->push_back(std::forward<V>(val));
+    }
+    template <typename NodeT>
+    static size_t copies(const NodeT* pn) { return 1 + (pn->bucket ? pn->bucket->size() : 0); }
+    // The copy removed is the latest one added to the bucket
+    template <typename NodeT>
+    static bool dropOne(NodeT* pn) {
+        if (!pn->bucket)
+            return true;
+        pn->bucket->pop_back();
+        if (pn->bucket->empty())
+            pn->bucket.reset();
+        return false;
+    }
+    template <typename NodeT>
+    static void copySlot(NodeT* dst, const NodeT* src) {
+        if (src->bucket)
+            dst->bucket.reset(new vector<typename remove_reference<decltype(src->data)>::type>(*src->bucket));
+    }
+};
+
+// ------------------------ Tracing policies ------------------------
+//  The tree reports what it does (inserts, fix-up cases, rotations) to a Trace policy.
+//  NoTrace is the default: its record() is empty and every report compiles away.
+//  CallbackTrace and RingBufferTrace are opt-in sinks that never format any text;
+//  StatsTrace only counts. Besides record(), a policy receives the number of
+//  comparisons of every search and the depth at which every new node is linked.
+
+// Events reported to the tracing policy, together with the data of the node involved
+enum TraceEvent {
+    TraceInsertRoot, TraceInserted, TraceErase,
+    TraceInsertCase1, TraceInsertCase2, TraceInsertCase3,
+    TraceInsertCase1B, TraceInsertCase2B, TraceInsertCase3B,
+    TraceDeleteCase1, TraceDeleteCase2, TraceDeleteCase3, TraceDeleteCase4,
+    TraceDeleteCase1B, TraceDeleteCase2B, TraceDeleteCase3B, TraceDeleteCase4B,
+    TraceRotateLeft, TraceRotateRight,
+    TraceEventCount
+};
+
+// Helper function to describe an event (for whoever decides to print it)
+inline const char* traceEventName(TraceEvent event) {
+    static const char* const names[TraceEventCount] = {
+        "Inserted as root", "Inserted (fixed)", "Erasing",
+        "Case 1: Parent and uncle are both red (RAF)",
+        "Case 2: Parent is red, uncle is black, and x is right child (BAR left)",
+        "Case 3: Parent is red, uncle is black, and x is left child (BAR right)",
+        "Case 1B: Parent and uncle are both red (RAF)",
+        "Case 2B: Parent is red, uncle is black, and x is left child (BAR right)",
+        "Case 3B: Parent is red, uncle is black, and x is right child (BAR left)",
+        "Delete case 1: Sibling is red (rotate left)",
+        "Delete case 2: Sibling and its children are black (recolor)",
+        "Delete case 3: Sibling's far child is black (rotate right)",
+        "Delete case 4: Sibling's far child is red (rotate left)",
+        "Delete case 1B: Sibling is red (rotate right)",
+        "Delete case 2B: Sibling and its children are black (recolor)",
+        "Delete case 3B: Sibling's far child is black (rotate left)",
+        "Delete case 4B: Sibling's far child is red (rotate right)",
+        "Rotate left", "Rotate right"
+    };
+    return names[event];
+}
+
+// No tracing: nothing is recorded and nothing is left in the generated code
+struct NoTrace {
+    template <typename T>
+    void record(TraceEvent, const T&) {}
+    void recordSearch(size_t) {}
+    void recordInsertDepth(size_t) {}
+};
+
+// Tracing through a user callback (a plain function pointer plus a context pointer)
+template <typename T>
+class CallbackTrace {
+public:
+    typedef void (*Callback)(TraceEvent event, const T& data, void* context);
+
+    CallbackTrace(Callback cb = nullptr, void* ctx = nullptr) : callback(cb), context(ctx) {}
+
+    void setCallback(Callback cb, void* ctx = nullptr) { callback = cb; context = ctx; }
+    void record(TraceEvent event, const T& data) {
+        if (callback != nullptr)
+            callback(event, data, context);
+    }
+    void recordSearch(size_t) {}
+    void recordInsertDepth(size_t) {}
+
+private:
+    Callback callback;
+    void*    context;
+};
+
+// Tracing into a fixed-size ring buffer that keeps the last Capacity events
+template <typename T, size_t Capacity = 256>
+class RingBufferTrace {
+public:
+    struct Entry {
+        TraceEvent event;
+        T          data;
+    };
+
+    RingBufferTrace() : total(0) {}
+
+    void record(TraceEvent event, const T& data) {
+        Entry& entry = entries[total % Capacity];
+        entry.event = event;
+        entry.data  = data;
+        total++;
+    }
+    void recordSearch(size_t) {}
+    void recordInsertDepth(size_t) {}
+
+    size_t size() const     { return total < Capacity ? total : Capacity; }
+    size_t recorded() const { return total; }     // including the overwritten ones
+    void   clear()          { total = 0; }
+
+    // Entry i of the buffer, 0 being the oldest event still kept
+    const Entry& operator[](size_t i) const {
+        size_t oldest = (total < Capacity ? 0 : total % Capacity);
+        return entries[(oldest + i) % Capacity];
+    }
+
+private:
+    Entry  entries[Capacity];
+    size_t total;
+};
+
+// Counters collected by StatsTrace: all O(1) to read and to reset
+struct TreeStats {
+    size_t events[TraceEventCount];     // times each event happened (rotations, fix-up cases...)
+    size_t searches;                    // calls to search()
+    size_t searchComparisons;           // comparisons made by those searches
+    size_t maxSearchComparisons;        // worst single search
+    size_t inserts;                     // nodes linked by insert/emplace
+    size_t insertDepthTotal;            // sum of the depths at which they were linked
+    size_t maxInsertDepth;              // deepest of them
+
+    size_t count(TraceEvent event) const { return events[event]; }
+    double averageSearchComparisons() const {
+        return searches == 0 ? 0.0 : double(searchComparisons) / double(searches);
+    }
+    double averageInsertDepth() const {
+        return inserts == 0 ? 0.0 : double(insertDepthTotal) / double(inserts);
+    }
+};
+
+// Tracing into counters only (see RedBlackTree::stats())
+class StatsTrace {
+public:
+    StatsTrace() { reset(); }
+
+    template <typename T>
+    void record(TraceEvent event, const T&) { counters.events[event]++; }
+
+    void recordSearch(size_t comparisons) {
+        counters.searches++;
+        counters.searchComparisons += comparisons;
+        if (comparisons > counters.maxSearchComparisons)
+            counters.maxSearchComparisons = comparisons;
+    }
+
+    void recordInsertDepth(size_t depth) {
+        counters.inserts++;
+        counters.insertDepthTotal += depth;
+        if (depth > counters.maxInsertDepth)
+            counters.maxInsertDepth = depth;
+    }
+
+    const TreeStats& stats() const { return counters; }
+    void             reset()       { counters = TreeStats(); }
+
+private:
+    TreeStats counters;
+};
+
+// Tracing of the keys whose paths changed, for RedBlackTree::validateIncremental():
+// the data of every inserted, erased or rotated node, and of the node an erase
+// unlinked a child from, is kept until the next check.
+// Past Limit pending keys only the fact that something changed is kept, and the
+// next check walks the whole tree.
+struct DirtyTraceTag {};
+
+template <typename T, size_t Limit = 4096>
+class DirtyTrace : public DirtyTraceTag {
+public:
+    DirtyTrace() : overflowed(false) {}
+
+    void record(TraceEvent event, const T& data) {
+        if (event != TraceInsertRoot && event != TraceInserted && event != TraceErase &&
+            event != TraceRotateLeft && event != TraceRotateRight)
+            return;
+        if (dirty.size() < Limit)
+            dirty.push_back(data);
+        else
+            overflowed = true;
+    }
+    void recordSearch(size_t) {}
+    void recordInsertDepth(size_t) {}
+
+    size_t pending() const  { return dirty.size(); }
+    bool   overflow() const { return overflowed; }
+    void   clear()          { dirty.clear(); overflowed = false; }
+
+    // Pending keys are handed to the checker from the most recent one
+    const T& next() const { return dirty.back(); }
+    void     pop()        { dirty.pop_back(); }
+
+private:
+    vector<T> dirty;
+    bool      overflowed;
+};
+
+// ------------------------ Invariant checks ------------------------
+//  RedBlackTree::validate() and validateIncremental() return the first broken
+//  invariant they find, DefectNone when the tree is sound.
+enum TreeDefect {
+    DefectNone,
+    DefectRedRoot,          // the root is red
+    DefectRedRed,           // a red node has a red child
+    DefectBlackHeight,      // two paths down from a node meet different numbers of black nodes
+    DefectParentLink,       // a child does not point back to its parent (or the root has a parent)
+    DefectOrder,            // a value is out of order with respect to an ancestor
+    DefectNodeCount,        // size() differs from the number of nodes
+    DefectRightmost,        // the cached largest node is not the largest node
+    TreeDefectCount
+};
+
+inline const char* treeDefectName(TreeDefect defect) {
+    static const char* const names[TreeDefectCount] = {
+        "No defect", "Red root", "Red node with a red child", "Unequal black heights",
+        "Broken parent link", "Values out of order", "Wrong node count", "Wrong rightmost node"
+    };
+    return names[defect];
+}
+
+// ------------------------ Traversals ------------------------
+//  RedBlackTree::traverse() visits the nodes in one of these orders without
+//  recursion; exportText() writes the same "data(COLOR) " text as print()
+//  chunk by chunk into a fixed buffer, with no string built per node.
+enum TraversalOrder { PreOrder, InOrder, PostOrder, LevelOrder };
+
+// Helper functions to format a value into buf as to_string() would (returns the length)
+template <typename T>
+typename enable_if<is_integral<T>::value && is_signed<T>::value, int>::type
+formatValue(char* buf, size_t size, const T& val) {
+    return snprintf(buf, size, "%lld", static_cast<long long>(val));
+}
+
+template <typename T>
+typename enable_if<is_integral<T>::value && !is_signed<T>::value, int>::type
+formatValue(char* buf, size_t size, const T& val) {
+    return snprintf(buf, size, "%llu", static_cast<unsigned long long>(val));
+}
+
+template <typename T>
+typename enable_if<is_floating_point<T>::value, int>::type
+formatValue(char* buf, size_t size, const T& val) {
+    return snprintf(buf, size, "%f", static_cast<double>(val));
+}
+
+// ------------------------ Binary image of a tree ------------------------
+//  save() writes a pointer-free image that load() reads back and that
+//  MappedRedBlackTree uses in place (see MappedRedBlackTree.h). Layout, native
+//  byte order, every section starting at the offsets given by TreeImageLayout:
+//      TreeImageHeader
+//      T        values[count]     in sorted order, node i holds values[i]
+//      uint32_t left[count]       index of the left child  (treeImageNil = none)
+//      uint32_t right[count]      index of the right child (treeImageNil = none)
+//      uint8_t  black[(count + 7) / 8]   bit i set = node i is BLACK
+//  Only trivially copyable values are stored, so each section is one memcpy.
+const uint32_t treeImageNil     = 0xFFFFFFFFu;
+const uint32_t treeImageVersion = 1;
+
+struct TreeImageHeader {
+    char     magic[8];      // "RBTIMAGE"
+    uint32_t version;       // treeImageVersion
+    uint32_t valueSize;     // sizeof(T) of the tree that wrote the image
+    uint64_t count;         // number of nodes
+    uint32_t root;          // index of the root node (treeImageNil when empty)
+    uint32_t reserved;
+};
+
+// Byte offsets of the sections of an image with count values of valueSize bytes
+struct TreeImageLayout {
+    uint64_t values, left, right, black, total;
+
+    TreeImageLayout(uint64_t count, uint64_t valueSize) {
+        values = sizeof(TreeImageHeader);
+        left   = (values + count * valueSize + 3) & ~uint64_t(3);
+        right  = left + count * sizeof(uint32_t);
+        black  = right + count * sizeof(uint32_t);
+        total  = black + (count + 7) / 8;
+    }
+};
+
+static_assert(sizeof(TreeImageHeader) == 32, "the image header has a fixed size");
+
+// Check the header of an image of values of valueSize bytes
+inline bool validTreeImageHeader(const TreeImageHeader& header, uint32_t valueSize) {
+    return memcmp(header.magic, "RBTIMAGE", 8) == 0 && header.version == treeImageVersion &&
+           header.valueSize == valueSize && header.count < treeImageNil &&
+           (header.count == 0 ? header.root == treeImageNil : header.root < header.count);
+}
+
+// ------------------------ Node structure for Red-Black Tree ------------------------
+// Tag selecting the in-place (emplace) constructor of a node
+struct EmplaceTag {};
+
+template <typename T, typename Augment = NoAugment, bool Compact = compactNodes>
+struct Node : public Augment {
+    T     data;
+    Node* left;
+    Node* right;
+
+    // Constructors - Build data in place, set color to RED and pointers to nullptr,
+    // and compute the augmented data of the node as a subtree of its own
+    Node(const T& val) : data(val), left(nullptr), right(nullptr), links(nullptr, RED) { Augment::update(this); }
+    Node(T&& val) : data(std::move(val)), left(nullptr), right(nullptr), links(nullptr, RED) { Augment::update(this); }
+
+    // Emplace constructor - data is built directly from the constructor arguments of T
+    template <typename... Args>
+    Node(EmplaceTag, Args&&... args)
+        : data(std::forward<Args>(args)...), left(nullptr), right(nullptr), links(nullptr, RED) {
+        Augment::update(this);
+    }
+
+    // Accessors for the parent pointer and the color (see compactNodes)
+    Node* getParent() const  { return links.getParent(); }
+    void  setParent(Node* p) { links.setParent(p); }
+    int   getColor() const   { return links.getColor(); }
+    void  setColor(int c)    { links.setColor(c); }
+
+    // Helper function to get data and color of a node
+    friend string getDataAndColor(const Node* pn) {
+        if (pn == nullptr)
+            return "NULL(BLACK)";
+        else
+            return to_string(pn->data)
+            + (pn->getColor() == RED ? "(RED)" : "(BLACK)");
+    }
+
+    void print() const {
+        cout << " [ " << getDataAndColor(this)
+            << "\t  P:" << getDataAndColor(getParent())
+            << "\t  L:" << getDataAndColor(left)
+            << "\t  R:" << getDataAndColor(right) << " ] ";
+    }
+
+private:
+    ParentAndColor<Node, Compact> links;
+};
+
+static_assert(alignof(Node<char>) >= 2, "compact nodes need the low bit of node addresses");
+
+// Helper function to get the color of a node (a nullptr child counts as BLACK)
+template <typename T, typename Augment, bool Compact>
+int colorOf(const Node<T, Augment, Compact>* pn) {
+    return pn == nullptr ? BLACK : pn->getColor();
+}
+
+// ------------------------ Node pool (arena) for Red-Black Tree ------------------------
+//  Nodes are carved out of contiguous blocks instead of one heap allocation per key.
+//  Blocks grow geometrically and are all returned together in O(blocks).
+//  The pool only hands out raw storage; constructing/destroying nodes is up to the tree.
+//  Freed slots are kept on an intrusive free list and handed out again first,
+//  so insert/erase churn neither grows the pool nor reaches the global allocator.
+//  Pools can be merged (splice) when trees are joined, and a pool can share its
+//  blocks with another one (share) when a tree is split in two.
+template <typename NodeT>
+class NodePool {
+private:
+    static const size_t firstBlockSize = 64;      // nodes in the first block
+    static const size_t maxBlockSize   = 65536;   // blocks stop doubling at this size
+
+    // A free slot stores the link to the next free slot in the node's own storage
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+    static_assert(sizeof(NodeT) >= sizeof(FreeSlot), "a node must be able to hold a free-list link");
+
+    // Blocks owned by several pools, given back when the last of them is released
+    struct SharedBlocks {
+        vector<NodeT*> blocks;
+        ~SharedBlocks() {
+            for (NodeT* block : blocks)
+                ::operator delete(block);
+        }
+    };
+
+    vector<NodeT*>                   blocks;    // every block owned by the pool alone
+    vector<shared_ptr<SharedBlocks>> shared;    // blocks owned together with other pools
+    NodeT*                           next;      // next unused slot in the newest block
+    NodeT*                           last;      // one past the end of the newest block
+    size_t                           blockSize; // number of nodes in the next block
+    FreeSlot*                        freeList;  // slots given back with deallocate()
+
+    void grow();
+
+public:
+    NodePool() : next(nullptr), last(nullptr), blockSize(firstBlockSize), freeList(nullptr) {}
+    ~NodePool() { release(); }
+
+    // A pool owns its blocks, so it can be moved but never copied
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    NodePool(NodePool&& other) noexcept;
+    NodePool& operator=(NodePool&& other) noexcept;
+
+    NodeT* allocate();
+    void   deallocate(NodeT* slot);
+    void   release();
+    void   swap(NodePool& other) noexcept;
+    void   splice(NodePool& other);
+    void   share(NodePool& other);
+};
+
+// Move constructor - steal the blocks of the other pool
+template <typename NodeT>
+NodePool<NodeT>::NodePool(NodePool&& other) noexcept
+    : next(nullptr), last(nullptr), blockSize(firstBlockSize), freeList(nullptr) {
+    swap(other);
+}
+
+// Move assignment - return our blocks, then steal the blocks of the other pool
+template <typename NodeT>
+NodePool<NodeT>& NodePool<NodeT>::operator=(NodePool&& other) noexcept {
+    if (this != &other) {
+        release();
+        swap(other);
+    }
+    return *this;
+}
+
+// Allocate a new block, twice as large as the previous one (up to maxBlockSize)
+template <typename NodeT>
+void NodePool<NodeT>::grow() {
+    // Make room for the entry first: a block allocated before a failing push_back would leak
+    if (blocks.size() == blocks.capacity())
+        blocks.reserve(blocks.empty() ? 8 : 2 * blocks.capacity());
+    NodeT* block = static_cast<NodeT*>(::operator new(blockSize * sizeof(NodeT)));
+    blocks.push_back(block);
+    next = block;
+    last = block + blockSize;
+    if (blockSize < maxBlockSize)
+        blockSize *= 2;
+}
+
+// Hand out storage for one node (the caller constructs it with placement new).
+// Recycled slots are used before carving new ones out of the newest block.
+template <typename NodeT>
+NodeT* NodePool<NodeT>::allocate() {
+    if (freeList != nullptr) {
+        FreeSlot* slot = freeList;
+        freeList = slot->next;
+        return reinterpret_cast<NodeT*>(slot);
+    }
+    if (next == last)
+        grow();
+    return next++;
+}
+
+// Give back the storage of one node (the caller has already destroyed it)
+template <typename NodeT>
+void NodePool<NodeT>::deallocate(NodeT* slot) {
+    FreeSlot* freed = new (slot) FreeSlot;
+    freed->next = freeList;
+    freeList = freed;
+}
+
+// Give every block back to the system (shared blocks once their last pool lets go).
+// Nodes are NOT destroyed here.
+template <typename NodeT>
+void NodePool<NodeT>::release() {
+    for (NodeT* block : blocks)
+        ::operator delete(block);
+    blocks.clear();
+    shared.clear();
+    next = last = nullptr;
+    blockSize = firstBlockSize;
+    freeList = nullptr;
+}
+
+template <typename NodeT>
+void NodePool<NodeT>::swap(NodePool& other) noexcept {
+    blocks.swap(other.blocks);
+    shared.swap(other.shared);
+    std::swap(next, other.next);
+    std::swap(last, other.last);
+    std::swap(blockSize, other.blockSize);
+    std::swap(freeList, other.freeList);
+}
+
+// Take over every block of the other pool, which is left empty. The unused end
+// of its newest block and its free slots are added to our free list.
+template <typename NodeT>
+void NodePool<NodeT>::splice(NodePool& other) {
+    if (this == &other)
+        return;
+    blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+    shared.insert(shared.end(), other.shared.begin(), other.shared.end());
+    for (NodeT* slot = other.next; slot != other.last; ++slot)
+        deallocate(slot);
+    while (other.freeList != nullptr) {
+        FreeSlot* slot = other.freeList;
+        other.freeList = slot->next;
+        deallocate(reinterpret_cast<NodeT*>(slot));
+    }
+    other.blocks.clear();
+    other.shared.clear();
+    other.next = other.last = nullptr;
+    other.blockSize = firstBlockSize;
+}
+
+// Hand our blocks over to a new shared set held by both pools, so nodes of this
+// pool can belong to a tree using the other one. Each pool keeps its own free
+// list and newest block, the storage is freed once both pools are released.
+template <typename NodeT>
+void NodePool<NodeT>::share(NodePool& other) {
+    if (this == &other || blocks.empty())
+        return;
+    shared_ptr<SharedBlocks> common = make_shared<SharedBlocks>();
+    common->blocks.swap(blocks);
+    shared.push_back(common);
+    other.shared.push_back(common);
+}
+
+// Red-Black Tree class ==========================================================================
+template <typename T, typename Augment = NoAugment, typename Trace = NoTrace, typename Duplicates = MultiKeys,
+          bool Compact = compactNodes>
+class RedBlackTree {
+public:
+    typedef Node<T, typename Duplicates::template NodeBase<T, Augment>, Compact> TreeNode;
+
+private:
+    TreeNode*          root;
+    TreeNode*          rightmost;   // node with the largest value (for appends)
+    size_t             nodeCount;
+    NodePool<TreeNode> pool;        // storage for every node of the tree
+    mutable Trace      tracer;      // receives the trace events (see TraceEvent)
+    vector<T>          frozenKeys;  // values in Eytzinger order, [1..n] (see freeze())
+    vector<TreeNode*>  frozenNodes; // node of each entry of frozenKeys
+    NodePool<TreeNode> compactPool; // fresh arena the nodes move to (see compact())
+    TreeNode*          compactNext; // next node to move, in sorted order
+    bool               compacting;  // a compact() run is under way
+
+    static const size_t searchGroupSize = 16;   // lookups in flight in searchMany()
+
+    // Private helper functions
+    void      rotateLeft(TreeNode* x);
+    void      rotateRight(TreeNode* x);
+    void      fixInsertion(TreeNode* x);
+    void      fixDeletion(TreeNode* x, TreeNode* xParent);
+    void      transplant(TreeNode* u, TreeNode* v);
+    void      updatePath(TreeNode* node);
+    TreeNode* search(TreeNode* node, const T& val) const;
+    template <typename... Args>
+    TreeNode* createNode(Args&&... args);
+    void      destroyNode(TreeNode* node);
+    TreeNode* insertNode(TreeNode* newNode);
+    TreeNode* insertNodeAt(TreeNode* hint, TreeNode* newNode);
+    void      destroyNodes(TreeNode* node);
+    void      cloneNodes(const TreeNode* node, TreeNode* parent, TreeNode*& slot);
+    TreeNode* linkNode(TreeNode* newNode, TreeNode* parent, bool asLeft);
+    void      recordLinkDepth(const TreeNode* parent);
+    void      buildFromSorted(vector<T>& items);
+    TreeNode* buildBalanced(vector<T>& items, size_t lo, size_t hi,
+                            int depth, int redDepth, TreeNode* parent);
+    static TreeNode* successor(TreeNode* node);
+    static TreeNode* predecessor(TreeNode* node);
+    static bool      precedes(const TreeNode* a, const TreeNode* b);
+    bool      isCompacted(const TreeNode* node) const;
+    TreeNode* relocateNode(TreeNode* node);
+    TreeNode* relocateInserted(TreeNode* node);
+    void      stopCompaction();
+
+    // Join, split and set operations work on detached subtrees and return the new
+    // subtree root; root is only used as scratch space by the rebalancing
+    static int       blackHeight(const TreeNode* node);
+    static void      detach(TreeNode* node, TreeNode*& l, TreeNode*& r);
+    static bool      containsNode(const TreeNode* node, const T& val);
+    static size_t    countNodes(TreeNode* node, true_type);
+    static size_t    countNodes(TreeNode* node, false_type);
+    static int       forkDepth(size_t n);
+    TreeNode* joinNodes(TreeNode* l, TreeNode* k, TreeNode* r);
+    TreeNode* joinNodes(TreeNode* l, TreeNode* r);
+    TreeNode* extractMax(TreeNode* node, TreeNode*& maxNode);
+    void      splitNodes(TreeNode* node, const T& key, TreeNode*& less, TreeNode*& notLess);
+    TreeNode* unionNodes(TreeNode* a, TreeNode* b, int forks);
+    TreeNode* filterNodes(TreeNode* node, const RedBlackTree& other, bool keepFound,
+                          vector<TreeNode*>& removed, int forks);
+    void      adoptRoot(TreeNode* newRoot, size_t count);
+    void      filter(const RedBlackTree& other, bool keepFound);
+    template <typename E, typename Fn>
+    static void overlapNodes(const TreeNode* node, const E& a, const E& b, Fn& fn);
+    size_t    frozenLowerBound(const T& val, size_t& comparisons) const;
+    TreeDefect checkSubtree(const TreeNode* node, const TreeNode* parent, const T* lo, const T* hi,
+                            int& height, size_t& count) const;
+    static TreeDefect checkNode(const TreeNode* node);
+    size_t    fillEytzinger(const vector<TreeNode*>& sorted, size_t i, size_t k);
+    static uint32_t imageNodes(const TreeNode* node, vector<T>& values, vector<uint32_t>& left,
+                               vector<uint32_t>& right, vector<uint8_t>& black);
+
+public:
+    // Bidirectional iterator over the values in sorted order. It steps with the
+    // parent links of the nodes, so iterating needs no stack and no allocation.
+    // Values are keys and cannot be modified in place (as with std::set).
+    class iterator {
+    public:
+        typedef bidirectional_iterator_tag iterator_category;
+        typedef T                          value_type;
+        typedef ptrdiff_t                  difference_type;
+        typedef const T*                   pointer;
+        typedef const T&                   reference;
+
+        iterator() : tree(nullptr), current(nullptr) {}
+        // A nullptr node is the end() position of the tree
+        iterator(const RedBlackTree* t, TreeNode* node) : tree(t), current(node) {}
+
+        reference operator*() const  { return current->data; }
+        pointer   operator->() const { return &current->data; }
+        TreeNode* node() const       { return current; }
+
+        iterator& operator++() { current = successor(current); return *this; }
+        iterator  operator++(int) { iterator old = *this; ++*this; return old; }
+        // Stepping back from end() lands on the largest value
+        iterator& operator--() {
+            current = (current == nullptr ? tree->maximum() : predecessor(current));
+            return *this;
+        }
+        iterator  operator--(int) { iterator old = *this; --*this; return old; }
+
+        bool operator==(const iterator& other) const { return current == other.current; }
+        bool operator!=(const iterator& other) const { return current != other.current; }
+
+    private:
+        const RedBlackTree* tree;
+        TreeNode*           current;
+    };
+    typedef iterator                        const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef reverse_iterator                const_reverse_iterator;
+
+    RedBlackTree() : root(nullptr), rightmost(nullptr), nodeCount(0), compactNext(nullptr), compacting(false) {}
+    explicit RedBlackTree(const Trace& t)
+        : root(nullptr), rightmost(nullptr), nodeCount(0), tracer(t), compactNext(nullptr), compacting(false) {}
+    template <typename Iter>
+    RedBlackTree(Iter first, Iter last);
+    ~RedBlackTree();
+
+    // The nodes belong to the tree's pool: moving is O(1) and steals the root
+    // and the pool, copying must be asked for explicitly with clone()
+    RedBlackTree(const RedBlackTree&) = delete;
+    RedBlackTree& operator=(const RedBlackTree&) = delete;
+    RedBlackTree(RedBlackTree&& other) noexcept;
+    RedBlackTree& operator=(RedBlackTree&& other) noexcept;
+    void          swap(RedBlackTree& other) noexcept;
+    RedBlackTree  clone() const;
+
+    // Public interface - insert() and emplace() return false when the value was
+    // folded into the node of an equal key instead (see the Duplicates policies)
+    bool      insert(const T& val);
+    bool      insert(T&& val);
+    iterator  insert(iterator hint, const T& val);
+    iterator  insert(iterator hint, T&& val);
+    template <typename... Args>
+    bool      emplace(Args&&... args);
+    bool      erase(const T& val);
+    void      erase(TreeNode* z);
+    void      clear();
+    template <typename Iter>
+    void      assignSorted(Iter first, Iter last);
+    template <typename Iter>
+    void      insertBatch(Iter first, Iter last);
+    size_t    size() const  { return nodeCount; }
+    bool      empty() const { return nodeCount == 0; }
+    TreeNode* search(const T& val) const;
+    size_t    count(const T& val) const;
+    // Batch search - out[i] = search(keys[i]), with the lookups interleaved
+    void      searchMany(const T* keys, size_t count, TreeNode** out) const;
+    void      searchMany(const vector<T>& keys, vector<TreeNode*>& out) const {
+        out.resize(keys.size());
+        searchMany(keys.data(), keys.size(), out.data());
+    }
+    void      print() const;
+
+    // Traversals without recursion: fn(data, color) for every node in the given
+    // order. Pre-, in- and post-order climb the parent links and need no stack;
+    // level order keeps one level of nodes at a time.
+    template <typename Fn>
+    void      traverse(TraversalOrder order, Fn fn) const;
+    // Text dump ("data(COLOR) " per node) handed to write(const char*, size_t)
+    // in chunks of up to chunkSize bytes, e.g. to a file or a socket
+    template <typename Write>
+    void      exportText(TraversalOrder order, Write write, size_t chunkSize = 65536) const;
+    void      writeText(ostream& out, TraversalOrder order = PreOrder) const;
+
+    // Tracing policy of the tree (e.g. to install a callback)
+    Trace&       trace()       { return tracer; }
+    const Trace& trace() const { return tracer; }
+
+    // Rebalancing and search counters (only with the StatsTrace policy)
+    const TreeStats& stats() const { return tracer.stats(); }
+    void             resetStats()  { tracer.reset(); }
+
+    // Invariant checks (see TreeDefect). validate() walks the whole tree, O(n).
+    // validateIncremental() checks the paths of at most budget of the keys recorded
+    // since the last call by the DirtyTrace policy, O(log^2 n) each; the keys left
+    // over wait for the next call. Black heights are only spot-checked there, one
+    // path per child. Bulk operations (buildFromSorted, join, split, set operations)
+    // record nothing: run validate() after them.
+    TreeDefect validate() const;
+    TreeDefect validateIncremental(size_t budget);
+
+    // Iteration in sorted order
+    iterator         begin() const  { return iterator(this, minimum()); }
+    iterator         end() const    { return iterator(this, nullptr); }
+    reverse_iterator rbegin() const { return reverse_iterator(end()); }
+    reverse_iterator rend() const   { return reverse_iterator(begin()); }
+    TreeNode*        minimum() const;
+    TreeNode*        maximum() const;
+    TreeNode*        getRoot() const { return root; }
+
+    // Range queries - nullptr stands for "past the last node"
+    TreeNode* lower_bound(const T& val) const;
+    TreeNode* upper_bound(const T& val) const;
+    pair<TreeNode*, TreeNode*> equal_range(const T& val) const;
+    template <typename Fn>
+    void      forEachInRange(const T& lo, const T& hi, Fn fn) const;
+
+    // Order statistics (only with the SubtreeSize augmentation)
+    TreeNode* select(size_t k) const;
+    size_t    rank(const T& val) const;
+
+    // Interval queries (only with the IntervalMax augmentation) on the closed
+    // interval [a, b]. overlaps() calls fn(data) for every interval overlapping
+    // it in sorted order; findOverlap() returns any one of them (nullptr if none).
+    template <typename E, typename Fn>
+    void      overlaps(const E& a, const E& b, Fn fn) const;
+    template <typename E>
+    TreeNode* findOverlap(const E& a, const E& b) const;
+
+    // Join and split by black height - O(log n) rebalancing, no node is copied.
+    // join needs every value of left <= key <= every value of right.
+    // split returns the values < key and the values >= key.
+    static RedBlackTree join(RedBlackTree&& left, const T& key, RedBlackTree&& right);
+    static pair<RedBlackTree, RedBlackTree> split(RedBlackTree&& tree, const T& key);
+
+    // Set operations built on join/split, run in parallel on large trees.
+    // unionWith keeps every value of both trees (as inserting them all would);
+    // intersectWith / differenceWith keep the values that are / are not in other.
+    void      unionWith(RedBlackTree&& other);
+    void      intersectWith(const RedBlackTree& other);
+    void      differenceWith(const RedBlackTree& other);
+
+    // Binary image of the tree (see TreeImageHeader), only for trivially copyable T.
+    // Both return false on an I/O error; load() also rejects an invalid image.
+    bool      save(const string& path) const;
+    bool      load(const string& path);
+
+    // Read-optimized copy of the values for read-mostly phases: freeze() lays them
+    // out in Eytzinger order, which then serves search() and lower_bound() until
+    // the next write drops it (thaw() drops it right away). Both layouts return
+    // the first of several equal values.
+    void      freeze();
+    void      thaw();
+    bool      isFrozen() const { return !frozenNodes.empty(); }
+
+    // Defragmentation after long insert/erase churn: each compact() step moves up
+    // to budget nodes, in sorted order, into a fresh arena, so in-order walks and
+    // range scans touch consecutive memory again. Returns true once every node has
+    // moved and the old arena is released. Writes may run between the steps.
+    // Moving a node invalidates the pointers and iterators to it. Bulk operations
+    // (assignSorted, join, split, set operations, clear) end the run: the nodes
+    // moved so far stay valid and the next compact() starts over.
+    bool      compact(size_t budget);
+    bool      isCompacting() const { return compacting; }
+};
+// ------------------------------------------------------------------------------------------------
+
+// Interval tree of closed intervals with endpoints of type E
+template <typename E>
+using IntervalTree = RedBlackTree<Interval<E>, IntervalMax<E>>;
+
+// Destructor
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::~RedBlackTree() {
+    clear();
+}
+
+// Move constructor - take over the root and the node pool of the other tree
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::RedBlackTree(RedBlackTree&& other) noexcept
+    : root(other.root), rightmost(other.rightmost), nodeCount(other.nodeCount),
+      pool(std::move(other.pool)), tracer(std::move(other.tracer)),
+      frozenKeys(std::move(other.frozenKeys)), frozenNodes(std::move(other.frozenNodes)),
+      compactPool(std::move(other.compactPool)), compactNext(other.compactNext), compacting(other.compacting) {
+    other.root = other.rightmost = nullptr;
+    other.nodeCount = 0;
+    other.compactNext = nullptr;
+    other.compacting = false;
+}
+
+// Move assignment - drop our nodes, then take over the other tree
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>&
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::operator=(RedBlackTree&& other) noexcept {
+    if (this != &other) {
+        clear();
+        root = other.root;
+        rightmost = other.rightmost;
+        nodeCount = other.nodeCount;
+        pool = std::move(other.pool);
+        tracer = std::move(other.tracer);
+        frozenKeys = std::move(other.frozenKeys);
+        frozenNodes = std::move(other.frozenNodes);
+        compactPool = std::move(other.compactPool);
+        compactNext = other.compactNext;
+        compacting = other.compacting;
+        other.thaw();
+        other.root = other.rightmost = nullptr;
+        other.nodeCount = 0;
+        other.compactNext = nullptr;
+        other.compacting = false;
+    }
+    return *this;
+}
+
+// Exchange the contents of two trees in O(1)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::swap(RedBlackTree& other) noexcept {
+    std::swap(root, other.root);
+    std::swap(rightmost, other.rightmost);
+    std::swap(nodeCount, other.nodeCount);
+    pool.swap(other.pool);
+    std::swap(tracer, other.tracer);
+    frozenKeys.swap(other.frozenKeys);
+    frozenNodes.swap(other.frozenNodes);
+    compactPool.swap(other.compactPool);
+    std::swap(compactNext, other.compactNext);
+    std::swap(compacting, other.compacting);
+}
+
+// Deep copy - duplicate the shape and the colors of the tree node by node,
+// so the copy costs O(n) with no comparison and no rebalancing
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::clone() const {
+    RedBlackTree<T, Augment, Trace, Duplicates, Compact> copy(tracer);
+    copy.cloneNodes(root, nullptr, copy.root);
+    copy.rightmost = copy.maximum();
+    copy.nodeCount = nodeCount;
+    return copy;
+}
+
+// Helper function to copy a subtree (preorder). Each copy is linked into its
+// parent right away, so a throwing copy of T leaves a tree that clear() can free.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::cloneNodes(const TreeNode* node, TreeNode* parent, TreeNode*& slot) {
+    if (node != nullptr) {
+        slot = createNode(node->data);
+        Duplicates::copySlot(slot, node);
+        slot->setColor(node->getColor());
+        slot->setParent(parent);
+        cloneNodes(node->left, slot, slot->left);
+        cloneNodes(node->right, slot, slot->right);
+        Augment::update(slot);
+    }
+}
+
+// Remove every node. Values are destroyed only when T needs it; the storage
+// is returned block by block in O(blocks)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::clear() {
+    if (!is_trivially_destructible<TreeNode>::value)
+        destroyNodes(root);
+    stopCompaction();
+    pool.release();
+    root = rightmost = nullptr;
+    nodeCount = 0;
+    thaw();
+}
+
+// Construct a node in storage taken from the pool (the storage goes back if T throws)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename... Args>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::createNode(Args&&... args) {
+    TreeNode* slot = pool.allocate();
+    try {
+        return new (slot) TreeNode(std::forward<Args>(args)...);
+    }
+    catch (...) {
+        pool.deallocate(slot);
+        throw;
+    }
+}
+
+// Destroy a single node and put its storage on the pool's free list
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::destroyNode(TreeNode* node) {
+    node->~TreeNode();
+    pool.deallocate(node);
+}
+
+// Helper function to run the destructor of every node (postorder)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::destroyNodes(TreeNode* node) {
+    if (node != nullptr) {
+        destroyNodes(node->left);
+        destroyNodes(node->right);
+        node->~TreeNode();
+    }
+}
+
+// Bulk-load constructor - build the tree from the range [first, last)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename Iter>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::RedBlackTree(Iter first, Iter last)
+    : root(nullptr), rightmost(nullptr), nodeCount(0), compactNext(nullptr), compacting(false) {
+    assignSorted(first, last);
+}
+
+// Replace the contents of the tree with the range [first, last).
+// Sorted input is turned into a balanced tree in O(n) without any rotation;
+// unsorted input is sorted first.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename Iter>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::assignSorted(Iter first, Iter last) {
+    vector<T> items(first, last);
+    if (!is_sorted(items.begin(), items.end()))
+        sort(items.begin(), items.end());
+
+    clear();
+    buildFromSorted(items);
+}
+
+// Helper function to build the whole tree from sorted items (the tree must be empty)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::buildFromSorted(vector<T>& items) {
+    thaw();
+    if (items.empty())
+        return;
+
+    if (Duplicates::foldsEqual) {
+        // One node per key: build from the first value of every run of equal keys,
+        // then fold the rest of each run into the node of its key
+        vector<size_t> runStart;
+        for (size_t i = 0; i < items.size(); i++)
+            if (i == 0 || items[i - 1] < items[i])
+                runStart.push_back(i);
+
+        if (runStart.size() < items.size()) {
+            vector<T> keys;
+            keys.reserve(runStart.size());
+            for (size_t start : runStart)
+                keys.push_back(std::move(items[start]));
+            buildFromSorted(keys);
+
+            size_t run = 0;
+            for (TreeNode* node = minimum(); node != nullptr; node = successor(node), run++) {
+                size_t runEnd = (run + 1 < runStart.size()) ? runStart[run + 1] : items.size();
+                for (size_t i = runStart[run] + 1; i < runEnd; i++)
+                    Duplicates::absorbValue(node, std::move(items[i]));
+            }
+            return;
+        }
+    }
+
+    // Splitting at the middle leaves all the leaves on the last two levels.
+    // Coloring the deepest level, floor(log2(n)), red and every other node black
+    // gives the same black height on every path.
+    int redDepth = 0;
+    for (size_t n = items.size(); n > 1; n >>= 1)
+        redDepth++;
+
+    root = buildBalanced(items, 0, items.size(), 0, redDepth, nullptr);
+    root->setColor(BLACK);
+    rightmost = maximum();
+    nodeCount = items.size();
+}
+
+// Helper function to build a subtree from the sorted items [lo, hi)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::buildBalanced(vector<T>& items, size_t lo, size_t hi,
+                                                           int depth, int redDepth, TreeNode* parent) {
+    if (lo >= hi)
+        return nullptr;
+
+    size_t   mid  = lo + (hi - lo) / 2;
+    TreeNode* node = createNode(std::move(items[mid]));
+    node->setColor(depth == redDepth ? RED : BLACK);
+    node->setParent(parent);
+    node->left   = buildBalanced(items, lo, mid, depth + 1, redDepth, node);
+    node->right  = buildBalanced(items, mid + 1, hi, depth + 1, redDepth, node);
+    Augment::update(node);
+    return node;
+}
+
+// Insertion functions - copy, move or build the value in place in a new node.
+// A value folded into the node of an equal key adds no node.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::insert(const T& val) {
+    size_t before = nodeCount;
+    insertNode(createNode(val));
+    return nodeCount != before;
+}
+
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::insert(T&& val) {
+    size_t before = nodeCount;
+    insertNode(createNode(std::move(val)));
+    return nodeCount != before;
+}
+
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename... Args>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::emplace(Args&&... args) {
+    size_t before = nodeCount;
+    insertNode(createNode(EmplaceTag(), std::forward<Args>(args)...));
+    return nodeCount != before;
+}
+
+// Link a newly constructed node into the tree, using its own data as the key.
+// Returns the node holding the value: newNode, or the node of an equal key when
+// the Duplicates policy folds equal keys (newNode is destroyed then).
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::insertNode(TreeNode* newNode) {
+    const T& val = newNode->data;
+
+    if (root == nullptr) {
+        // If tree is empty, make new node as root and color it black
+        root = rightmost = newNode;
+        root->setColor(BLACK);
+        nodeCount = 1;
+        thaw();
+        tracer.record(TraceInsertRoot, root->data);
+        tracer.recordInsertDepth(0);
+        return compacting ? relocateInserted(newNode) : newNode;
+    }
+
+    // Traverse to find the appropriate position for the new node
+    // (one comparison per level, equal keys go to the right)
+    TreeNode* current = root;
+    TreeNode* parent = nullptr;
+    TreeNode* notGreater = nullptr;     // last node the descent went right of (data <= val)
+    bool      goLeft = false;
+    size_t    depth = 0;
+
+    while (current != nullptr) {
+        parent = current;
+        goLeft = val < current->data;
+        if (!goLeft)
+            notGreater = current;
+        current = goLeft ? current->left : current->right;
+        depth++;
+    }
+    tracer.recordInsertDepth(depth);
+
+    // With a folding policy, an equal key is the last node not greater than val
+    if (Duplicates::foldsEqual && notGreater != nullptr && !(notGreater->data < val)) {
+        Duplicates::absorb(notGreater, newNode);
+        destroyNode(newNode);
+        return notGreater;
+    }
+
+    return linkNode(newNode, parent, goLeft);
+}
+
+// Hinted insertion - hint is the position just after the place where val belongs,
+// e.g. end() for a value not smaller than any value in the tree (appends).
+// A correct hint skips the descent from the root: the node is linked next to the
+// hint and only fixInsertion runs, which is amortized O(1) (traced trees also
+// climb to the root to report the depth). A wrong hint costs a couple of
+// comparisons before falling back to a plain insert.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::iterator
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::insert(iterator hint, const T& val) {
+    return iterator(this, insertNodeAt(hint.node(), createNode(val)));
+}
+
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::iterator
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::insert(iterator hint, T&& val) {
+    return iterator(this, insertNodeAt(hint.node(), createNode(std::move(val))));
+}
+
+// Link newNode just before hint (nullptr = after the largest value) if its
+// value belongs there, otherwise insert it from the root. Returns the node
+// holding the value (see insertNode()). Folding policies always take the
+// descent from the root, which is where equal keys are found.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::insertNodeAt(TreeNode* hint, TreeNode* newNode) {
+    const T& val = newNode->data;
+
+    if (root != nullptr && !Duplicates::foldsEqual) {
+        if (hint == nullptr) {
+            // Append: the largest node has no right child
+            if (!(val < rightmost->data)) {
+                recordLinkDepth(rightmost);
+                return linkNode(newNode, rightmost, false);
+            }
+        }
+        else if (!(hint->data < val)) {
+            // val <= hint: it belongs right before the hint if the previous value is <= val
+            if (hint->left == nullptr) {
+                TreeNode* before = predecessor(hint);
+                if (before == nullptr || !(val < before->data)) {
+                    recordLinkDepth(hint);
+                    return linkNode(newNode, hint, true);
+                }
+            }
+            else {
+                // The previous value is the largest of the left subtree: it has no right child
+                TreeNode* before = hint->left;
+                while (before->right != nullptr)
+                    before = before->right;
+                if (!(val < before->data)) {
+                    recordLinkDepth(before);
+                    return linkNode(newNode, before, false);
+                }
+            }
+        }
+    }
+    return insertNode(newNode);
+}
+
+// Helper function for the inserts that skip the descent from the root (hinted
+// inserts, batches): report the depth of a node linked below parent. It takes a
+// climb to the root, so the untraced tree skips it.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::recordLinkDepth(const TreeNode* parent) {
+    if (is_same<Trace, NoTrace>::value)
+        return;
+    size_t depth = 1;
+    for (; parent->getParent() != nullptr; parent = parent->getParent())
+        depth++;
+    tracer.recordInsertDepth(depth);
+}
+
+// Attach newNode as the left or right child (currently empty) of parent, then rebalance.
+// Returns the node, which has moved to the new arena if it lands in the part of
+// the tree a compact() run is done with.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::linkNode(TreeNode* newNode, TreeNode* parent, bool asLeft) {
+    // Set the parent for the new node
+    newNode->setParent(parent);
+
+    // Insert the new node on the side chosen by the last comparison
+    if (asLeft)
+        parent->left = newNode;
+    else {
+        parent->right = newNode;
+        if (parent == rightmost)
+            rightmost = newNode;
+    }
+    nodeCount++;
+    thaw();
+    updatePath(parent);
+
+    // Fix any violations of Red-Black Tree properties
+    fixInsertion(newNode);
+    tracer.record(TraceInserted, newNode->data);
+    return compacting ? relocateInserted(newNode) : newNode;
+}
+
+// Insert every value of [first, last). The batch is sorted first; then
+//  - a batch that is large compared to the tree (k >= n / batchRebuildRatio)
+//    is merged with the contents of the tree and the whole tree is rebuilt
+//    with the O(n + k) bulk-load path,
+//  - a smaller batch is inserted in order, each descent starting from the node
+//    inserted just before instead of from the root (keys in a sorted batch are
+//    close to each other, so the walk is short and stays in cache).
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename Iter>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::insertBatch(Iter first, Iter last) {
+    const size_t batchRebuildRatio = 4;
+
+    vector<T> batch(first, last);
+    if (batch.empty())
+        return;
+    if (!is_sorted(batch.begin(), batch.end()))
+        sort(batch.begin(), batch.end());
+
+    // (a rebuild keeps one value per node: not for trees whose nodes count copies)
+    if (batch.size() * batchRebuildRatio >= nodeCount && (!Duplicates::extraCopies || nodeCount == 0)) {
+        vector<T> items;
+        items.reserve(nodeCount + batch.size());
+
+        // Merge the tree (walked in order) with the batch, moving the values out
+        size_t next = 0;
+        for (TreeNode* node = minimum(); node != nullptr; node = successor(node)) {
+            while (next < batch.size() && batch[next] < node->data)
+                items.push_back(std::move(batch[next++]));
+            items.push_back(std::move(node->data));
+        }
+        while (next < batch.size())
+            items.push_back(std::move(batch[next++]));
+
+        clear();
+        buildFromSorted(items);
+        return;
+    }
+
+    if (Duplicates::foldsEqual) {
+        // Equal keys are found by the descent from the root
+        for (size_t i = 0; i < batch.size(); i++)
+            insertNode(createNode(std::move(batch[i])));
+        return;
+    }
+
+    TreeNode* previous = nullptr;
+    for (size_t i = 0; i < batch.size(); i++) {
+        TreeNode* newNode = createNode(std::move(batch[i]));
+        const T&  val = newNode->data;
+
+        // Climb from the previous node until its subtree is certain to hold val:
+        // that is when we come up a left link whose parent is greater than val
+        TreeNode* current = root;
+        if (previous != nullptr) {
+            current = previous;
+            while (current->getParent() != nullptr &&
+                   !(current == current->getParent()->left && val < current->getParent()->data))
+                current = current->getParent();
+        }
+
+        TreeNode* parent = nullptr;
+        bool      goLeft = false;
+        while (current != nullptr) {
+            parent = current;
+            goLeft = val < current->data;
+            current = goLeft ? current->left : current->right;
+        }
+
+        recordLinkDepth(parent);
+        previous = linkNode(newNode, parent, goLeft);
+    }
+}
+
+// Fix violations of Red-Black Tree properties after insertion --------------
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::fixInsertion(TreeNode* x) {
+
+    // Beginning with node x, continue fixing until the tree is a valid Red-Black Tree
+    while (x != root && x->getParent()->getColor() == RED) {
+
+        //Is the parent a left child?
+        if (x->getParent() == x->getParent()->getParent()->left) {
+            TreeNode* uncle = x->getParent()->getParent()->right;
+            if (uncle && uncle->getColor() == RED) {
+                tracer.record(TraceInsertCase1, x->data);
+                // Case 1: Parent and uncle are both red
+                x->getParent()->setColor(BLACK);
+                uncle->setColor(BLACK);
+                x->getParent()->getParent()->setColor(RED);
+                x = x->getParent()->getParent();
+            }
+            else {
+                // Case 2: Parent is red but uncle is black or absent
+
+                if (x == x->getParent()->right) {
+                    tracer.record(TraceInsertCase2, x->data);
+                    x = x->getParent();
+                    rotateLeft(x);
+                }
+                // Case 3: Parent is red, uncle is black, and x is left child
+                tracer.record(TraceInsertCase3, x->data);
+                x->getParent()->setColor(BLACK);
+                x->getParent()->getParent()->setColor(RED);
+                rotateRight(x->getParent()->getParent());
+            }
+        }
+        else {
+            // Symmetric cases for a parent that is a right child
+            TreeNode* uncle = x->getParent()->getParent()->left;
+
+            if (uncle && uncle->getColor() == RED) {
+                tracer.record(TraceInsertCase1B, x->data);
+                x->getParent()->setColor(BLACK);
+                uncle->setColor(BLACK);
+                x->getParent()->getParent()->setColor(RED);
+                x = x->getParent()->getParent();
+            }
+            else {
+                if (x == x->getParent()->left) {
+                    tracer.record(TraceInsertCase2B, x->data);
+                    x = x->getParent();
+                    rotateRight(x);
+                }
+                tracer.record(TraceInsertCase3B, x->data);
+                x->getParent()->setColor(BLACK);
+                x->getParent()->getParent()->setColor(RED);
+                rotateLeft(x->getParent()->getParent());
+            }
+        }
+    }
+
+    // Make sure the root is ALWAYS black
+    root->setColor(BLACK);
+}
+
+// Deletion functions ------------------------------------------------------
+// Remove one copy of val (a node of its own, or one of the copies counted in the
+// node of the key with a folding policy). Returns false when val is not in the tree.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::erase(const T& val) {
+    TreeNode* z = search(val);
+    if (z == nullptr)
+        return false;
+    if (Duplicates::dropOne(z))
+        erase(z);
+    return true;
+}
+
+// Remove node z from the tree. Nodes are relinked rather than having their data
+// copied around, so pointers to every other node stay valid.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::erase(TreeNode* z) {
+    tracer.record(TraceErase, z->data);
+    thaw();
+    // During a compact() run z lives in the new arena when the run has passed it
+    bool moved = compacting && isCompacted(z);
+    if (z == compactNext)
+        compactNext = successor(z);
+    if (z == rightmost)
+        rightmost = predecessor(z);
+
+    TreeNode* y = z;                     // node actually unlinked from its position
+    int      yOriginalColor = y->getColor();
+    TreeNode* x;                         // node moving into y's position (may be nullptr)
+    TreeNode* xParent;                   // parent of x, also when x is nullptr
+
+    if (z->left == nullptr) {
+        x = z->right;
+        xParent = z->getParent();
+        transplant(z, z->right);
+    }
+    else if (z->right == nullptr) {
+        x = z->left;
+        xParent = z->getParent();
+        transplant(z, z->left);
+    }
+    else {
+        // Two children: z is replaced by its successor y, the minimum of the right subtree
+        y = z->right;
+        while (y->left != nullptr)
+            y = y->left;
+        yOriginalColor = y->getColor();
+        x = y->right;
+
+        if (y->getParent() == z)
+            xParent = y;
+        else {
+            xParent = y->getParent();
+            transplant(y, y->right);
+            y->right = z->right;
+            y->right->setParent(y);
+        }
+        transplant(z, y);
+        y->left = z->left;
+        y->left->setParent(y);
+        y->setColor(z->getColor());
+    }
+
+    // Where a child was unlinked: the links and colors changed from there up, also
+    // below the path to z's value when y came from deeper in the right subtree
+    if (xParent != nullptr)
+        tracer.record(TraceErase, xParent->data);
+
+    // Every subtree below the old position of y lost a node
+    updatePath(xParent);
+
+    // Removing a black node shortens the black height of x's path
+    if (yOriginalColor == BLACK)
+        fixDeletion(x, xParent);
+
+    if (moved) {
+        z->~TreeNode();
+        compactPool.deallocate(z);
+    }
+    else
+        destroyNode(z);
+    nodeCount--;
+}
+
+// Replace the subtree rooted at u with the subtree rooted at v
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::transplant(TreeNode* u, TreeNode* v) {
+    if (u->getParent() == nullptr)
+        root = v;
+    else if (u == u->getParent()->left)
+        u->getParent()->left = v;
+    else
+        u->getParent()->right = v;
+    if (v != nullptr)
+        v->setParent(u->getParent());
+}
+
+// Recompute the augmented data of node and of all its ancestors
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::updatePath(TreeNode* node) {
+    if (Augment::enabled)
+        for (; node != nullptr; node = node->getParent())
+            Augment::update(node);
+}
+
+// Fix violations of Red-Black Tree properties after deletion --------------
+// x carries an extra black; xParent is needed because x may be nullptr
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::fixDeletion(TreeNode* x, TreeNode* xParent) {
+
+    while (x != root && colorOf(x) == BLACK) {
+
+        //Is x a left child?
+        if (x == xParent->left) {
+            TreeNode* sibling = xParent->right;
+            if (sibling->getColor() == RED) {
+                tracer.record(TraceDeleteCase1, xParent->data);
+                sibling->setColor(BLACK);
+                xParent->setColor(RED);
+                rotateLeft(xParent);
+                sibling = xParent->right;
+            }
+            if (colorOf(sibling->left) == BLACK && colorOf(sibling->right) == BLACK) {
+                tracer.record(TraceDeleteCase2, xParent->data);
+                sibling->setColor(RED);
+                x = xParent;
+                xParent = x->getParent();
+            }
+            else {
+                if (colorOf(sibling->right) == BLACK) {
+                    tracer.record(TraceDeleteCase3, xParent->data);
+                    sibling->left->setColor(BLACK);
+                    sibling->setColor(RED);
+                    rotateRight(sibling);
+                    sibling = xParent->right;
+                }
+                tracer.record(TraceDeleteCase4, xParent->data);
+                sibling->setColor(xParent->getColor());
+                xParent->setColor(BLACK);
+                sibling->right->setColor(BLACK);
+                rotateLeft(xParent);
+                x = root;
+            }
+        }
+        else {
+            // Symmetric cases for x being a right child
+            TreeNode* sibling = xParent->left;
+            if (sibling->getColor() == RED) {
+                tracer.record(TraceDeleteCase1B, xParent->data);
+                sibling->setColor(BLACK);
+                xParent->setColor(RED);
+                rotateRight(xParent);
+                sibling = xParent->left;
+            }
+            if (colorOf(sibling->left) == BLACK && colorOf(sibling->right) == BLACK) {
+                tracer.record(TraceDeleteCase2B, xParent->data);
+                sibling->setColor(RED);
+                x = xParent;
+                xParent = x->getParent();
+            }
+            else {
+                if (colorOf(sibling->left) == BLACK) {
+                    tracer.record(TraceDeleteCase3B, xParent->data);
+                    sibling->right->setColor(BLACK);
+                    sibling->setColor(RED);
+                    rotateLeft(sibling);
+                    sibling = xParent->left;
+                }
+                tracer.record(TraceDeleteCase4B, xParent->data);
+                sibling->setColor(xParent->getColor());
+                xParent->setColor(BLACK);
+                sibling->left->setColor(BLACK);
+                rotateRight(xParent);
+                x = root;
+            }
+        }
+    }
+
+    if (x != nullptr)
+        x->setColor(BLACK);
+}
+
+// Left rotation
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::rotateLeft(TreeNode* x) {
+    /*  Rotate left around x  (x goes to the left side) -------------
+
+                        XP                      XP
+                      /                        /
+                     X        ------>         Y
+                    /  \                    /  \
+                   XL   Y                  X   YR
+                       /  \              /  \
+                      YL   YR           XL   YL
+
+         x is the node to be rotated
+         y is the right child of x
+         x's right child becomes y's left child
+         y's parent becomes x's parent
+         y's left child becomes x
+         x's parent becomes y
+         x's parent's child becomes y
+         y becomes the parent of x
+         x becomes the left child of y
+     ---------------------------------------------------
+     */
+     // y is the right child of x
+    tracer.record(TraceRotateLeft, x->data);
+    TreeNode* y = x->right;
+
+    x->right = y->left;
+    if (y->left != nullptr) y->left->setParent(x);
+
+    y->setParent(x->getParent());
+
+    if (x->getParent() == nullptr)
+        root = y;
+    else if (x == x->getParent()->left)
+        x->getParent()->left = y;
+    else
+        x->getParent()->right = y;
+
+    y->left = x;
+    x->setParent(y);
+
+    // x is now below y: update it first
+    Augment::update(x);
+    Augment::update(y);
+}
+
+// Right rotation
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::rotateRight(TreeNode* x) {
+    /* ---------------------------------------------------------
+
+    Right rotate around x (x goes to the right side)
+            XP                      XP
+            |                        |
+            X        ------>         Y
+           /  \                     /  \
+          Y    XR                  YL   X
+         /  \                          /  \
+        YL   YR                      YR   XR
+
+         x is the node to be rotated
+         y is the left child of x
+         x's left child becomes y's right child
+         y's parent becomes x's parent
+         y's right child becomes x
+         x's parent becomes y
+         x's parent's child becomes y
+         y becomes the parent of x
+         x becomes the right child of y
+    --------------------------------------------------------- */
+
+    tracer.record(TraceRotateRight, x->data);
+    TreeNode* y = x->left;
+    x->left = y->right;
+    if (y->right != nullptr)
+        y->right->setParent(x);
+    y->setParent(x->getParent());
+    if (x->getParent() == nullptr)
+        root = y;
+    else if (x == x->getParent()->right)
+        x->getParent()->right = y;
+    else
+        x->getParent()->left = y;
+    y->right = x;
+    x->setParent(y);
+
+    Augment::update(x);
+    Augment::update(y);
+}
+
+// Search function - iterative, using only operator<.
+// Each level costs a single comparison: the walk remembers the last node with
+// data >= val and checks it for equality once, after reaching the bottom.
+// Among equal values it returns the first one in sorted order, the node that
+// lower_bound() and the frozen layout give as well.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::search(TreeNode* node, const T& val) const {
+    TreeNode* candidate = nullptr;
+    size_t    comparisons = 0;
+
+    while (node != nullptr) {
+        comparisons++;
+        if (node->data < val)
+            node = node->right;
+        else {
+            candidate = node;
+            node = node->left;
+        }
+    }
+
+    if (candidate != nullptr) {
+        comparisons++;
+        if (!(val < candidate->data)) {
+            tracer.recordSearch(comparisons);
+            return candidate;
+        }
+    }
+    tracer.recordSearch(comparisons);
+    return nullptr;
+}
+
+// Wrapper for search function
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::search(const T& val) const {
+    if (isFrozen()) {
+        size_t comparisons = 0;
+        size_t k = frozenLowerBound(val, comparisons);
+        tracer.recordSearch(comparisons + 1);
+        return (k != 0 && !(val < frozenKeys[k])) ? frozenNodes[k] : nullptr;
+    }
+    return search(root, val);
+}
+
+// Batch search - the lookups advance together, searchGroupSize at a time (AMAC):
+// each round moves every lookup in flight one level down and prefetches the child
+// it goes to, so the cache misses of different keys overlap instead of queuing up.
+// A finished lookup hands its slot to the next key at once. The walk of each key is
+// the one of search(): the same comparisons, the same node for equal keys.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::searchMany(const T* keys, size_t count,
+                                                             TreeNode** out) const {
+    // The frozen layout is searched one key at a time (its search prefetches already)
+    if (isFrozen() || root == nullptr) {
+        for (size_t i = 0; i < count; i++)
+            out[i] = search(keys[i]);
+        return;
+    }
+
+    struct Lookup {
+        TreeNode* node;
+        TreeNode* candidate;    // last node with data >= key, as in search()
+        size_t    key;          // index into keys
+        size_t    comparisons;
+    };
+    Lookup inFlight[searchGroupSize];
+    size_t active = 0;
+    size_t next = 0;
+    while (active < searchGroupSize && next < count) {
+        inFlight[active] = Lookup{ root, nullptr, next++, 0 };
+        active++;
+    }
+
+    while (active > 0) {
+        for (size_t slot = 0; slot < active;) {
+            Lookup&  lookup = inFlight[slot];
+            const T& val = keys[lookup.key];
+            if (lookup.node != nullptr) {
+                lookup.comparisons++;
+                if (lookup.node->data < val)
+                    lookup.node = lookup.node->right;
+                else {
+                    lookup.candidate = lookup.node;
+                    lookup.node = lookup.node->left;
+                }
+                // Prefetching nullptr is harmless: a prefetch never faults
+                RBT_PREFETCH(lookup.node);
+                slot++;
+                continue;
+            }
+
+            // Reached the bottom: check the candidate, then start the next key in this slot
+            TreeNode* found = nullptr;
+            if (lookup.candidate != nullptr) {
+                lookup.comparisons++;
+                if (!(val < lookup.candidate->data))
+                    found = lookup.candidate;
+            }
+            out[lookup.key] = found;
+            tracer.recordSearch(lookup.comparisons);
+
+            if (next < count)
+                lookup = Lookup{ root, nullptr, next++, 0 };
+            else
+                lookup = inFlight[--active];
+        }
+    }
+}
+
+// Number of copies of val in the tree
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+size_t RedBlackTree<T, Augment, Trace, Duplicates, Compact>::count(const T& val) const {
+    size_t copies = 0;
+    for (TreeNode* node = lower_bound(val); node != nullptr && !(val < node->data); node = successor(node))
+        copies += Duplicates::copies(node);
+    return copies;
+}
+
+// Range queries -----------------------------------------------------------
+// Return the first node whose data is not less than val (nullptr if none)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::lower_bound(const T& val) const {
+    if (isFrozen()) {
+        size_t comparisons = 0;
+        return frozenNodes[frozenLowerBound(val, comparisons)];
+    }
+
+    TreeNode* result = nullptr;
+    TreeNode* node = root;
+    while (node != nullptr) {
+        if (node->data < val)
+            node = node->right;
+        else {
+            result = node;
+            node = node->left;
+        }
+    }
+    return result;
+}
+
+// Return the first node whose data is greater than val (nullptr if none)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::upper_bound(const T& val) const {
+    TreeNode* result = nullptr;
+    TreeNode* node = root;
+    while (node != nullptr) {
+        if (val < node->data) {
+            result = node;
+            node = node->left;
+        }
+        else
+            node = node->right;
+    }
+    return result;
+}
+
+// Return the nodes [first, last) holding values equal to val
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+pair<typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*,
+     typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::equal_range(const T& val) const {
+    return make_pair(lower_bound(val), upper_bound(val));
+}
+
+// Call fn(data) for every value in [lo, hi), in ascending order.
+// One descent finds lo, then the walk follows the parent links from node to
+// successor, so only the nodes in the range (plus O(log n)) are touched.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename Fn>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::forEachInRange(const T& lo, const T& hi, Fn fn) const {
+    for (TreeNode* node = lower_bound(lo); node != nullptr && node->data < hi; node = successor(node))
+        fn(node->data);
+}
+
+// Return the node with the smallest value (nullptr for an empty tree)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::minimum() const {
+    TreeNode* node = root;
+    if (node != nullptr)
+        while (node->left != nullptr)
+            node = node->left;
+    return node;
+}
+
+// Return the node with the largest value (nullptr for an empty tree)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::maximum() const {
+    TreeNode* node = root;
+    if (node != nullptr)
+        while (node->right != nullptr)
+            node = node->right;
+    return node;
+}
+
+// Helper function to get the next node in sorted order (nullptr after the last one)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::successor(TreeNode* node) {
+    if (node->right != nullptr) {
+        node = node->right;
+        while (node->left != nullptr)
+            node = node->left;
+        return node;
+    }
+    // Climb while we come from a right child
+    TreeNode* parent = node->getParent();
+    while (parent != nullptr && node == parent->right) {
+        node = parent;
+        parent = parent->getParent();
+    }
+    return parent;
+}
+
+// Helper function to get the previous node in sorted order (nullptr before the first one)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::predecessor(TreeNode* node) {
+    if (node->left != nullptr) {
+        node = node->left;
+        while (node->right != nullptr)
+            node = node->right;
+        return node;
+    }
+    // Climb while we come from a left child
+    TreeNode* parent = node->getParent();
+    while (parent != nullptr && node == parent->left) {
+        node = parent;
+        parent = parent->getParent();
+    }
+    return parent;
+}
+
+// Order statistics --------------------------------------------------------
+// Return the node holding the k-th smallest value (k = 0 is the minimum),
+// or nullptr when k >= number of nodes. O(log n) using the subtree sizes.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::select(size_t k) const {
+    static_assert(is_base_of<SubtreeSize, Augment>::value, "select() needs the SubtreeSize augmentation");
+
+    TreeNode* node = root;
+    while (node != nullptr) {
+        size_t leftSize = SubtreeSize::sizeOf(node->left);
+        if (k < leftSize)
+            node = node->left;
+        else if (k == leftSize)
+            return node;
+        else {
+            k -= leftSize + 1;
+            node = node->right;
+        }
+    }
+    return nullptr;
+}
+
+// Return the number of values strictly smaller than val. O(log n).
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+size_t RedBlackTree<T, Augment, Trace, Duplicates, Compact>::rank(const T& val) const {
+    static_assert(is_base_of<SubtreeSize, Augment>::value, "rank() needs the SubtreeSize augmentation");
+
+    size_t    smaller = 0;
+    TreeNode* node = root;
+    while (node != nullptr) {
+        if (node->data < val) {
+            smaller += SubtreeSize::sizeOf(node->left) + 1;
+            node = node->right;
+        }
+        else
+            node = node->left;
+    }
+    return smaller;
+}
+
+// Join, split and set operations ------------------------------------------
+// Number of BLACK nodes on a path from node down to a leaf (0 for nullptr)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+int RedBlackTree<T, Augment, Trace, Duplicates, Compact>::blackHeight(const TreeNode* node) {
+    int height = 0;
+    for (; node != nullptr; node = node->left)
+        if (node->getColor() == BLACK)
+            height++;
+    return height;
+}
+
+// Cut node off its two subtrees, which become detached trees of their own
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::detach(TreeNode* node, TreeNode*& l, TreeNode*& r) {
+    l = node->left;
+    r = node->right;
+    if (l != nullptr) l->setParent(nullptr);
+    if (r != nullptr) r->setParent(nullptr);
+    node->left = node->right = nullptr;
+    node->setParent(nullptr);
+}
+
+// Is val in the subtree? (read only and untraced, so it can run on several threads)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::containsNode(const TreeNode* node, const T& val) {
+    const TreeNode* candidate = nullptr;
+    while (node != nullptr) {
+        if (val < node->data)
+            node = node->left;
+        else {
+            candidate = node;
+            node = node->right;
+        }
+    }
+    return candidate != nullptr && !(candidate->data < val);
+}
+
+// Number of nodes in a subtree: read from the root with SubtreeSize, counted otherwise
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+size_t RedBlackTree<T, Augment, Trace, Duplicates, Compact>::countNodes(TreeNode* node, true_type) {
+    return SubtreeSize::sizeOf(node);
+}
+
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+size_t RedBlackTree<T, Augment, Trace, Duplicates, Compact>::countNodes(TreeNode* node, false_type) {
+    size_t count = 0;
+    if (node != nullptr) {
+        while (node->left != nullptr)
+            node = node->left;
+        for (; node != nullptr; node = successor(node))
+            count++;
+    }
+    return count;
+}
+
+// How many levels of the set operations get a thread of their own: enough to
+// keep every core busy, stopping before the pieces get too small to pay off
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+int RedBlackTree<T, Augment, Trace, Duplicates, Compact>::forkDepth(size_t n) {
+    const size_t parallelGrain = 4096;      // smallest piece worth a thread
+
+    size_t threads = thread::hardware_concurrency();
+    int    depth = 0;
+    while ((size_t(1) << depth) < threads && (n >> depth) > parallelGrain)
+        depth++;
+    return depth;
+}
+
+// Join the trees l and r with the single node k in between (l <= k <= r).
+// k is hung on the spine of the taller tree at the first BLACK node with the
+// black height of the shorter one, colored RED, then fixInsertion repairs a
+// possible red-red violation above it. Costs O(|height(l) - height(r)| + 1).
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::joinNodes(TreeNode* l, TreeNode* k, TreeNode* r) {
+    // Black roots: then k, which is RED, always gets BLACK children
+    if (l != nullptr) l->setColor(BLACK);
+    if (r != nullptr) r->setColor(BLACK);
+    int hl = blackHeight(l);
+    int hr = blackHeight(r);
+
+    k->setColor(RED);
+    if (hl == hr) {
+        k->left = l;
+        k->right = r;
+        if (l != nullptr) l->setParent(k);
+        if (r != nullptr) r->setParent(k);
+        k->setParent(nullptr);
+        k->setColor(BLACK);
+        Augment::update(k);
+        return k;
+    }
+
+    TreeNode* parent = nullptr;
+    if (hl > hr) {
+        // Walk down the right spine of l
+        TreeNode* c = l;
+        int       h = hl;
+        while (!(colorOf(c) == BLACK && h == hr)) {
+            if (c->getColor() == BLACK)
+                h--;
+            parent = c;
+            c = c->right;
+        }
+        k->left = c;
+        k->right = r;
+        parent->right = k;
+        root = l;
+        if (c != nullptr) c->setParent(k);
+        if (r != nullptr) r->setParent(k);
+    }
+    else {
+        // Walk down the left spine of r
+        TreeNode* c = r;
+        int       h = hr;
+        while (!(colorOf(c) == BLACK && h == hl)) {
+            if (c->getColor() == BLACK)
+                h--;
+            parent = c;
+            c = c->left;
+        }
+        k->left = l;
+        k->right = c;
+        parent->left = k;
+        root = r;
+        if (l != nullptr) l->setParent(k);
+        if (c != nullptr) c->setParent(k);
+    }
+    k->setParent(parent);
+    updatePath(k);
+
+    fixInsertion(k);
+    return root;
+}
+
+// Join the trees l and r (l <= r): the largest node of l goes in between
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::joinNodes(TreeNode* l, TreeNode* r) {
+    if (l == nullptr)
+        return r;
+    if (r == nullptr)
+        return l;
+    TreeNode* maxNode = nullptr;
+    TreeNode* rest = extractMax(l, maxNode);
+    return joinNodes(rest, maxNode, r);
+}
+
+// Remove the largest node of a tree; returns the remaining tree
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::extractMax(TreeNode* node, TreeNode*& maxNode) {
+    TreeNode *l, *r;
+    detach(node, l, r);
+    if (r == nullptr) {
+        maxNode = node;
+        return l;
+    }
+    TreeNode* rest = extractMax(r, maxNode);
+    return joinNodes(l, node, rest);
+}
+
+// Split a tree into the values < key and the values >= key. Every level of the
+// descent joins one subtree back onto each side, O(log n) in total.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::splitNodes(TreeNode* node, const T& key,
+                                                             TreeNode*& less, TreeNode*& notLess) {
+    if (node == nullptr) {
+        less = notLess = nullptr;
+        return;
+    }
+    TreeNode *l, *r, *a, *b;
+    detach(node, l, r);
+    if (node->data < key) {
+        splitNodes(r, key, a, b);
+        less = joinNodes(l, node, a);
+        notLess = b;
+    }
+    else {
+        splitNodes(l, key, a, b);
+        less = a;
+        notLess = joinNodes(b, node, r);
+    }
+}
+
+// Union of two trees: split b around the root of a, unite the two halves
+// (the right ones on another thread while forks > 0), join them back with the root
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::unionNodes(TreeNode* a, TreeNode* b, int forks) {
+    if (a == nullptr)
+        return b;
+    if (b == nullptr)
+        return a;
+
+    TreeNode *la, *ra, *lb, *rb, *l, *r;
+    detach(a, la, ra);
+    splitNodes(b, a->data, lb, rb);
+
+    future<TreeNode*> right;
+    if (forks > 0) {
+        try {
+            // The other thread rebalances in a tree object of its own
+            right = async(launch::async, [=]() {
+                RedBlackTree worker;
+                TreeNode*    result = worker.unionNodes(ra, rb, forks - 1);
+                worker.root = nullptr;
+                return result;
+            });
+        }
+        catch (const system_error&) {
+            // No thread available: stay on this one
+        }
+    }
+    l = unionNodes(la, lb, forks - 1);
+    r = right.valid() ? right.get() : unionNodes(ra, rb, forks - 1);
+    return joinNodes(l, a, r);
+}
+
+// Rebuild a tree from the nodes whose value is (keepFound) or is not (!keepFound)
+// in other. Dropped nodes are collected in removed; the caller destroys them.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::filterNodes(TreeNode* node, const RedBlackTree& other,
+                                                         bool keepFound, vector<TreeNode*>& removed,
+                                                         int forks) {
+    if (node == nullptr)
+        return nullptr;
+
+    TreeNode *l, *r;
+    detach(node, l, r);
+
+    future<TreeNode*>  right;
+    vector<TreeNode*>  removedRight;
+    if (forks > 0) {
+        try {
+            right = async(launch::async, [=, &other, &removedRight]() {
+                RedBlackTree worker;
+                TreeNode*    result = worker.filterNodes(r, other, keepFound, removedRight, forks - 1);
+                worker.root = nullptr;
+                return result;
+            });
+        }
+        catch (const system_error&) {
+        }
+    }
+    l = filterNodes(l, other, keepFound, removed, forks - 1);
+    r = right.valid() ? right.get() : filterNodes(r, other, keepFound, removed, forks - 1);
+    removed.insert(removed.end(), removedRight.begin(), removedRight.end());
+
+    if (containsNode(other.root, node->data) == keepFound)
+        return joinNodes(l, node, r);
+    removed.push_back(node);
+    return joinNodes(l, r);
+}
+
+// Make newRoot (a detached tree of count nodes) the whole tree
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::adoptRoot(TreeNode* newRoot, size_t count) {
+    root = newRoot;
+    if (root != nullptr) {
+        root->setParent(nullptr);
+        root->setColor(BLACK);
+    }
+    rightmost = maximum();
+    nodeCount = count;
+    thaw();
+}
+
+// Join left, a new node holding key and right. Both trees are left empty.
+// With a folding Duplicates policy, key must be strictly between the two trees.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::join(RedBlackTree&& left, const T& key,
+                                                  RedBlackTree&& right) {
+    left.stopCompaction();
+    right.stopCompaction();
+    RedBlackTree result(std::move(left));
+    TreeNode*    k = result.createNode(key);
+    TreeNode*    l = result.root;
+    TreeNode*    r = right.root;
+    size_t       count = result.nodeCount + right.nodeCount + 1;
+
+    // The nodes of right now live in the pool of the result
+    result.pool.splice(right.pool);
+    right.root = right.rightmost = nullptr;
+    right.nodeCount = 0;
+    right.thaw();
+
+    result.adoptRoot(result.joinNodes(l, k, r), count);
+    return result;
+}
+
+// Split tree into the values < key and the values >= key; tree is left empty.
+// Both halves keep using the storage of the original pool (see NodePool::share).
+// The halves are counted in O(log n) with SubtreeSize, by walking the first half otherwise.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+pair<RedBlackTree<T, Augment, Trace, Duplicates, Compact>, RedBlackTree<T, Augment, Trace, Duplicates, Compact>>
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::split(RedBlackTree&& tree, const T& key) {
+    tree.stopCompaction();
+    RedBlackTree less(std::move(tree));
+    RedBlackTree notLess;
+    less.pool.share(notLess.pool);
+
+    size_t    total = less.nodeCount;
+    TreeNode* all = less.root;
+    TreeNode *l, *r;
+    less.splitNodes(all, key, l, r);
+
+    size_t lessCount = countNodes(l, integral_constant<bool, is_base_of<SubtreeSize, Augment>::value>());
+    less.adoptRoot(l, lessCount);
+    notLess.adoptRoot(r, total - lessCount);
+    return make_pair(std::move(less), std::move(notLess));
+}
+
+// Add every node of other to the tree (other is left empty). O(m log(n/m + 1))
+// work for trees of m <= n nodes, spread over the cores for large trees.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::unionWith(RedBlackTree&& other) {
+    if (this == &other || other.root == nullptr)
+        return;
+    stopCompaction();
+    other.stopCompaction();
+
+    if (Duplicates::foldsEqual) {
+        // Equal keys of the two trees have to end up in one node: the nodes of
+        // other are relinked into this tree one by one, O(m log n) on one thread
+        vector<TreeNode*> nodes;
+        for (TreeNode* node = other.minimum(); node != nullptr; node = successor(node))
+            nodes.push_back(node);
+        pool.splice(other.pool);
+        other.root = other.rightmost = nullptr;
+        other.nodeCount = 0;
+        other.thaw();
+        thaw();
+        for (TreeNode* node : nodes) {
+            node->left = node->right = nullptr;
+            node->setParent(nullptr);
+            node->setColor(RED);
+            Augment::update(node);
+            insertNode(node);
+        }
+        return;
+    }
+
+    TreeNode* a = root;
+    TreeNode* b = other.root;
+    size_t    count = nodeCount + other.nodeCount;
+    // Splitting the smaller tree around the nodes of the larger one is cheaper
+    if (nodeCount < other.nodeCount)
+        std::swap(a, b);
+
+    pool.splice(other.pool);
+    other.root = other.rightmost = nullptr;
+    other.nodeCount = 0;
+    other.thaw();
+
+    adoptRoot(unionNodes(a, b, forkDepth(count)), count);
+}
+
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::intersectWith(const RedBlackTree& other) {
+    if (this != &other)
+        filter(other, true);
+}
+
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::differenceWith(const RedBlackTree& other) {
+    if (this == &other)
+        clear();
+    else
+        filter(other, false);
+}
+
+// Interval queries ---------------------------------------------------------
+// A subtree whose largest high end is below a holds no overlap, and nothing right
+// of a node whose low end is above b does either. Every other node visited lies on
+// the path to b or above a reported interval: O(log n + k log(n/k)) for k results,
+// and O(log n) when they are consecutive in sorted order.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename E, typename Fn>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::overlaps(const E& a, const E& b, Fn fn) const {
+    static_assert(is_base_of<IntervalMaxTag, Augment>::value, "overlaps() needs the IntervalMax augmentation");
+    overlapNodes(root, a, b, fn);
+}
+
+// Helper function for overlaps(): the left subtrees are searched by recursion,
+// O(log n) deep, the right ones by the loop
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename E, typename Fn>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::overlapNodes(const TreeNode* node, const E& a, const E& b, Fn& fn) {
+    while (node != nullptr && !(node->maxHigh < a)) {
+        overlapNodes(node->left, a, b, fn);
+        if (b < node->data.low)
+            return;
+        if (!(node->data.high < a))
+            fn(node->data);
+        node = node->right;
+    }
+}
+
+// Descend towards an overlap, O(log n): when the left subtree reaches up to a,
+// either it holds an overlap or no interval starting later can (its low end is
+// after b), so the search never has to come back up
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename E>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::findOverlap(const E& a, const E& b) const {
+    static_assert(is_base_of<IntervalMaxTag, Augment>::value, "findOverlap() needs the IntervalMax augmentation");
+
+    TreeNode* node = root;
+    while (node != nullptr && (b < node->data.low || node->data.high < a)) {
+        if (node->left != nullptr && !(node->left->maxHigh < a))
+            node = node->left;
+        else
+            node = node->right;
+    }
+    return node;
+}
+
+// Helper function for intersectWith / differenceWith
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::filter(const RedBlackTree& other, bool keepFound) {
+    stopCompaction();
+    vector<TreeNode*> removed;
+    TreeNode*         all = root;
+    root = nullptr;
+
+    TreeNode* kept = filterNodes(all, other, keepFound, removed, forkDepth(nodeCount));
+    adoptRoot(kept, nodeCount - removed.size());
+    for (TreeNode* node : removed)
+        destroyNode(node);
+}
+
+// Binary image ------------------------------------------------------------
+// Helper function to number the nodes in sorted order (inorder) and record the
+// children and the color of each one. Returns the index given to node.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+uint32_t RedBlackTree<T, Augment, Trace, Duplicates, Compact>::imageNodes(const TreeNode* node, vector<T>& values,
+                                                                 vector<uint32_t>& left, vector<uint32_t>& right,
+                                                                 vector<uint8_t>& black) {
+    if (node == nullptr)
+        return treeImageNil;
+
+    uint32_t leftIndex = imageNodes(node->left, values, left, right, black);
+    uint32_t index = uint32_t(values.size());
+    values.push_back(node->data);
+    left.push_back(leftIndex);
+    right.push_back(treeImageNil);
+    if (node->getColor() == BLACK)
+        black[index / 8] |= uint8_t(1u << (index % 8));
+    right[index] = imageNodes(node->right, values, left, right, black);
+    return index;
+}
+
+// Write the tree to path: header, then each section of the image in one write
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::save(const string& path) const {
+    static_assert(is_trivially_copyable<T>::value, "save() needs a trivially copyable value type");
+    static_assert(!Duplicates::extraCopies, "an image holds one value per node, not counted copies");
+    if (nodeCount >= treeImageNil)
+        return false;
+
+    vector<T>        values;
+    vector<uint32_t> left, right;
+    vector<uint8_t>  black((nodeCount + 7) / 8, 0);
+    values.reserve(nodeCount);
+    left.reserve(nodeCount);
+    right.reserve(nodeCount);
+
+    TreeImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "RBTIMAGE", 8);
+    header.version = treeImageVersion;
+    header.valueSize = uint32_t(sizeof(T));
+    header.count = nodeCount;
+    header.root = imageNodes(root, values, left, right, black);
+
+    TreeImageLayout layout(nodeCount, sizeof(T));
+    const char      padding[4] = { 0, 0, 0, 0 };
+
+    ofstream out(path.c_str(), ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (nodeCount > 0) {
+        out.write(reinterpret_cast<const char*>(values.data()), streamsize(nodeCount * sizeof(T)));
+        out.write(padding, streamsize(layout.left - layout.values - nodeCount * sizeof(T)));
+        out.write(reinterpret_cast<const char*>(left.data()), streamsize(nodeCount * sizeof(uint32_t)));
+        out.write(reinterpret_cast<const char*>(right.data()), streamsize(nodeCount * sizeof(uint32_t)));
+        out.write(reinterpret_cast<const char*>(black.data()), streamsize(black.size()));
+    }
+    out.close();
+    return !out.fail();
+}
+
+// Replace the contents of the tree with the image in path. The values are read
+// in one block and, being sorted already, rebuilt with the O(n) bulk-load path
+// (no comparison beyond the sortedness check, no fixInsertion, no rotation).
+// The tree is left unchanged when the image cannot be read.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::load(const string& path) {
+    static_assert(is_trivially_copyable<T>::value, "load() needs a trivially copyable value type");
+
+    ifstream in(path.c_str(), ios::binary);
+    TreeImageHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        !validTreeImageHeader(header, uint32_t(sizeof(T))))
+        return false;
+
+    // The header is not trusted with the size of the buffer: the file must hold
+    // the whole image it announces (as MappedRedBlackTree::open() checks)
+    streamoff headerEnd = streamoff(sizeof(header));
+    in.seekg(0, ios::end);
+    streamoff length = in.tellg();
+    in.seekg(headerEnd);
+    if (!in || length < 0 || TreeImageLayout(header.count, sizeof(T)).total > uint64_t(length))
+        return false;
+
+    vector<T> values(size_t(header.count));
+    if (header.count > 0 &&
+        !in.read(reinterpret_cast<char*>(values.data()), streamsize(header.count * sizeof(T))))
+        return false;
+    if (!is_sorted(values.begin(), values.end()))
+        return false;
+
+    clear();
+    buildFromSorted(values);
+    return true;
+}
+
+// Frozen layout ------------------------------------------------------------
+// Copy the values into an implicit complete binary tree stored level by level
+// (Eytzinger order: the children of entry k are 2k and 2k+1). The top levels
+// share a few cache lines, and the entries searched a few levels further down
+// are contiguous, so they can be prefetched before they are needed.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::freeze() {
+    thaw();
+    if (root == nullptr)
+        return;
+
+    vector<TreeNode*> sorted;
+    sorted.reserve(nodeCount);
+    for (TreeNode* node = minimum(); node != nullptr; node = successor(node))
+        sorted.push_back(node);
+
+    // Entry 0 is unused: frozenNodes[0] = nullptr is what lower_bound() returns
+    // when every value is smaller than the one looked for
+    frozenNodes.assign(nodeCount + 1, nullptr);
+    fillEytzinger(sorted, 0, 1);
+    frozenKeys.reserve(nodeCount + 1);
+    frozenKeys.push_back(sorted[0]->data);
+    for (size_t k = 1; k <= nodeCount; k++)
+        frozenKeys.push_back(frozenNodes[k]->data);
+}
+
+// Drop the frozen layout and its memory
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::thaw() {
+    if (!frozenNodes.empty()) {
+        vector<T>().swap(frozenKeys);
+        vector<TreeNode*>().swap(frozenNodes);
+    }
+}
+
+// Compaction ---------------------------------------------------------------
+// The run walks the nodes in sorted order: every node before compactNext has
+// moved to compactPool, compactNext and every node after it are still in pool.
+// Writes between the steps keep it that way (see relocateInserted() and erase()),
+// so once compactNext runs off the end the old pool holds no node any more.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::compact(size_t budget) {
+    if (!compacting) {
+        compacting = true;
+        compactNext = minimum();
+    }
+    if (compactNext != nullptr)
+        thaw();     // the frozen layout points at the nodes
+
+    for (size_t moved = 0; compactNext != nullptr && moved < budget; moved++) {
+        // The cursor moves on only once the node has: if moving its value throws,
+        // compactNext still names the node, which stays in the old pool
+        TreeNode* next = successor(compactNext);
+        relocateNode(compactNext);
+        compactNext = next;
+    }
+    if (compactNext != nullptr)
+        return false;
+
+    // Only the storage of moved (destroyed) nodes is left in the old pool
+    pool.swap(compactPool);
+    compactPool.release();
+    compacting = false;
+    return true;
+}
+
+// End a compact() run: the arena keeps the nodes moved so far, so it joins the pool
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::stopCompaction() {
+    if (compacting) {
+        pool.splice(compactPool);
+        compactNext = nullptr;
+        compacting = false;
+    }
+}
+
+// Helper function to move a node into the new arena and relink its neighbours
+// to the copy. Returns the moved node; node itself is destroyed, its storage
+// is released with the old pool.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::relocateNode(TreeNode* node) {
+    TreeNode* slot = compactPool.allocate();
+    TreeNode* moved;
+    try {
+        moved = new (slot) TreeNode(std::move(*node));
+    }
+    catch (...) {
+        compactPool.deallocate(slot);
+        throw;
+    }
+    node->~TreeNode();
+
+    TreeNode* parent = moved->getParent();
+    if (parent == nullptr)
+        root = moved;
+    else if (parent->left == node)
+        parent->left = moved;
+    else
+        parent->right = moved;
+    if (moved->left != nullptr)
+        moved->left->setParent(moved);
+    if (moved->right != nullptr)
+        moved->right->setParent(moved);
+    if (rightmost == node)
+        rightmost = moved;
+    return moved;
+}
+
+// Helper function for inserts during a compact() run: a node linked in the part
+// the run is done with has to move to the new arena right away
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+typename RedBlackTree<T, Augment, Trace, Duplicates, Compact>::TreeNode*
+RedBlackTree<T, Augment, Trace, Duplicates, Compact>::relocateInserted(TreeNode* node) {
+    return isCompacted(node) ? relocateNode(node) : node;
+}
+
+// Helper function to tell whether a compact() run has passed node (so that it
+// lives in the new arena). Distinct values are ordered by one comparison,
+// equal ones by their position in the tree.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::isCompacted(const TreeNode* node) const {
+    if (compactNext == nullptr)
+        return true;
+    if (node->data < compactNext->data)
+        return true;
+    if (compactNext->data < node->data)
+        return false;
+    return precedes(node, compactNext);
+}
+
+// Helper function to tell whether node a comes before node b in sorted order:
+// both climb to their lowest common ancestor, O(log n)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+bool RedBlackTree<T, Augment, Trace, Duplicates, Compact>::precedes(const TreeNode* a, const TreeNode* b) {
+    size_t depthA = 0, depthB = 0;
+    for (const TreeNode* node = a; node->getParent() != nullptr; node = node->getParent())
+        depthA++;
+    for (const TreeNode* node = b; node->getParent() != nullptr; node = node->getParent())
+        depthB++;
+
+    // childA / childB: the last node each climb came up from
+    const TreeNode* childA = nullptr;
+    const TreeNode* childB = nullptr;
+    for (; depthA > depthB; depthA--) {
+        childA = a;
+        a = a->getParent();
+    }
+    for (; depthB > depthA; depthB--) {
+        childB = b;
+        b = b->getParent();
+    }
+    if (a == b) {
+        // One node is an ancestor of the other (or they are the same node)
+        if (childA != nullptr)
+            return childA == b->left;
+        return childB != nullptr && childB == a->right;
+    }
+    while (a != b) {
+        childA = a;
+        a = a->getParent();
+        childB = b;
+        b = b->getParent();
+    }
+    return childA == a->left;
+}
+
+// Helper function to place sorted[i..] at entry k and below (inorder of the
+// implicit tree). Returns the index of the next sorted node to place.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+size_t RedBlackTree<T, Augment, Trace, Duplicates, Compact>::fillEytzinger(const vector<TreeNode*>& sorted, size_t i, size_t k) {
+    if (k <= nodeCount) {
+        i = fillEytzinger(sorted, i, 2 * k);
+        frozenNodes[k] = sorted[i++];
+        i = fillEytzinger(sorted, i, 2 * k + 1);
+    }
+    return i;
+}
+
+// Helper function to find the entry of the first value not less than val
+// (0 if there is none). The descent has no branch on the comparison: the
+// result only picks the next index. The entries 4 levels below, 16 consecutive
+// ones, are prefetched while the current level is compared.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+size_t RedBlackTree<T, Augment, Trace, Duplicates, Compact>::frozenLowerBound(const T& val, size_t& comparisons) const {
+    const T* keys = frozenKeys.data();
+    size_t   n = nodeCount;
+    size_t   k = 1;
+
+    while (k <= n) {
+        if (16 * k <= n)
+            RBT_PREFETCH(keys + 16 * k);
+        k = 2 * k + size_t(keys[k] < val);
+        comparisons++;
+    }
+    // Going right appended a 1 bit, going left a 0 bit: the answer is the node
+    // where the path last went left, found by dropping the trailing 1 bits
+    while (k & 1)
+        k >>= 1;
+    return k >> 1;
+}
+
+// Invariant checks --------------------------------------------------------
+// Helper function for validate(): check the subtree of node, whose values must lie
+// in [lo, hi] (nullptr = unbounded), and give its black height and its node count.
+// The walk keeps its own stack of the nodes still waiting for their right subtree:
+// a corrupt tree can be one long chain, deeper than the call stack would allow.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+TreeDefect RedBlackTree<T, Augment, Trace, Duplicates, Compact>::checkSubtree(const TreeNode* node,
+                                                                     const TreeNode* parent,
+                                                                     const T* lo, const T* hi,
+                                                                     int& height, size_t& count) const {
+    struct Frame {
+        const TreeNode* node;
+        const T*        hi;             // upper bound of node's subtree
+        int             leftHeight;     // -1 until the left subtree is checked
+    };
+    vector<Frame> frames;
+
+    for (;;) {
+        // Down the left spine: check each node against its parent and its bounds.
+        // Equal keys may end up on either side after rotations: bounds are inclusive
+        while (node != nullptr) {
+            if (node->getParent() != parent)
+                return DefectParentLink;
+            if ((lo != nullptr && node->data < *lo) || (hi != nullptr && *hi < node->data))
+                return DefectOrder;
+            if (node->getColor() == RED && (colorOf(node->left) == RED || colorOf(node->right) == RED))
+                return DefectRedRed;
+            frames.push_back(Frame{ node, hi, -1 });
+            parent = node;
+            hi = &node->data;
+            node = node->left;
+        }
+        height = 1;     // nullptr counts as a black leaf, as in getDataAndColor
+
+        // Up again: finish the nodes whose two subtrees are checked, then go on with
+        // the right subtree of the first node that has not seen it yet
+        for (;;) {
+            if (frames.empty())
+                return DefectNone;
+            Frame& top = frames.back();
+            if (top.leftHeight < 0) {
+                top.leftHeight = height;
+                parent = top.node;
+                lo = &top.node->data;
+                hi = top.hi;
+                node = top.node->right;
+                break;
+            }
+            if (top.leftHeight != height)
+                return DefectBlackHeight;
+            height += (top.node->getColor() == BLACK ? 1 : 0);
+            count++;
+            frames.pop_back();
+        }
+    }
+}
+
+// Check every invariant on the whole tree
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+TreeDefect RedBlackTree<T, Augment, Trace, Duplicates, Compact>::validate() const {
+    if (colorOf(root) == RED)
+        return DefectRedRoot;
+
+    int        height;
+    size_t     count = 0;
+    TreeDefect defect = checkSubtree(root, nullptr, nullptr, nullptr, height, count);
+    if (defect != DefectNone)
+        return defect;
+    if (count != nodeCount)
+        return DefectNodeCount;
+    if (rightmost != maximum())
+        return DefectRightmost;
+    return DefectNone;
+}
+
+// Helper function for validateIncremental(): the invariants between node and its
+// children, and a spot check of the black heights below it. Each child's height is
+// taken down its left spine only, so a mismatch between two deeper paths is missed;
+// measuring every path would cost O(size of the subtree), which validate() does.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+TreeDefect RedBlackTree<T, Augment, Trace, Duplicates, Compact>::checkNode(const TreeNode* node) {
+    const TreeNode* children[2] = { node->left, node->right };
+    for (const TreeNode* child : children) {
+        if (child == nullptr)
+            continue;
+        if (child->getParent() != node)
+            return DefectParentLink;
+        if (node->getColor() == RED && child->getColor() == RED)
+            return DefectRedRed;
+    }
+    if ((node->left != nullptr && node->data < node->left->data) ||
+        (node->right != nullptr && node->right->data < node->data))
+        return DefectOrder;
+    if (blackHeight(node->left) != blackHeight(node->right))
+        return DefectBlackHeight;
+    return DefectNone;
+}
+
+// Check the paths from the root to the keys changed since the last call (at most
+// budget of them). Only the nodes on those paths and their children are looked at,
+// which covers every node a rotation or recoloring of the change can have moved.
+// The red-red, order and parent-link checks on these nodes are exact, the black
+// heights are only spot-checked (see checkNode()): a clean result is strong
+// evidence, not a proof, that the tree is sound; validate() gives the proof.
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+TreeDefect RedBlackTree<T, Augment, Trace, Duplicates, Compact>::validateIncremental(size_t budget) {
+    static_assert(is_base_of<DirtyTraceTag, Trace>::value, "validateIncremental() needs the DirtyTrace policy");
+    if (tracer.overflow()) {
+        tracer.clear();
+        return validate();
+    }
+
+    if (colorOf(root) == RED)
+        return DefectRedRoot;
+    if (root != nullptr && root->getParent() != nullptr)
+        return DefectParentLink;
+
+    for (size_t checked = 0; checked < budget && tracer.pending() > 0; checked++) {
+        const T& key = tracer.next();
+        for (const TreeNode* node = root; node != nullptr;
+             node = (node->data < key) ? node->right : node->left) {
+            TreeDefect defect = checkNode(node);
+            if (defect != DefectNone)
+                return defect;
+        }
+        tracer.pop();
+    }
+    return DefectNone;
+}
+
+// Traversals --------------------------------------------------------------
+// Pre-, in- and post-order walk the tree with the parent links: where the walk
+// comes from (the parent, the left child or the right child) tells what is left
+// to do at a node, so no stack is needed at any depth
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename Fn>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::traverse(TraversalOrder order, Fn fn) const {
+    if (order == LevelOrder) {
+        vector<const TreeNode*> level, next;
+        if (root != nullptr)
+            level.push_back(root);
+        while (!level.empty()) {
+            for (const TreeNode* node : level) {
+                fn(node->data, node->getColor());
+                if (node->left != nullptr)
+                    next.push_back(node->left);
+                if (node->right != nullptr)
+                    next.push_back(node->right);
+            }
+            level.swap(next);
+            next.clear();
+        }
+        return;
+    }
+
+    const TreeNode* previous = nullptr;
+    const TreeNode* node = root;
+    while (node != nullptr) {
+        const TreeNode* parent = node->getParent();
+        if (previous == parent) {
+            // First visit, coming down
+            if (order == PreOrder)
+                fn(node->data, node->getColor());
+            if (node->left != nullptr) {
+                previous = node;
+                node = node->left;
+                continue;
+            }
+        }
+        if (previous == parent || previous == node->left) {
+            // Left subtree done
+            if (order == InOrder)
+                fn(node->data, node->getColor());
+            if (node->right != nullptr) {
+                previous = node;
+                node = node->right;
+                continue;
+            }
+        }
+        // Both subtrees done
+        if (order == PostOrder)
+            fn(node->data, node->getColor());
+        previous = node;
+        node = parent;
+    }
+}
+
+// Format every node into a fixed buffer, handed to write() whenever the next
+// node might not fit
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+template <typename Write>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::exportText(TraversalOrder order, Write write,
+                                                             size_t chunkSize) const {
+    const size_t maxValue = 384;            // enough for any formatted number
+    const size_t maxEntry = maxValue + 8;   // and its "(BLACK) "
+    vector<char> buffer(chunkSize > maxEntry ? chunkSize : maxEntry);
+    size_t       used = 0;
+
+    traverse(order, [&](const T& data, int color) {
+        if (buffer.size() - used < maxEntry) {
+            write(buffer.data(), used);
+            used = 0;
+        }
+        int length = formatValue(buffer.data() + used, maxValue, data);
+        if (length > 0)
+            used += (size_t(length) < maxValue) ? size_t(length) : maxValue - 1;
+        const char* suffix = (color == RED) ? "(RED) " : "(BLACK) ";
+        size_t      suffixLength = strlen(suffix);
+        memcpy(buffer.data() + used, suffix, suffixLength);
+        used += suffixLength;
+    });
+    if (used > 0)
+        write(buffer.data(), used);
+}
+
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::writeText(ostream& out, TraversalOrder order) const {
+    exportText(order, [&out](const char* data, size_t length) {
+        out.write(data, streamsize(length));
+    });
+}
+
+// Public function to print tree (preorder)
+template <typename T, typename Augment, typename Trace, typename Duplicates, bool Compact>
+void RedBlackTree<T, Augment, Trace, Duplicates, Compact>::print() const {
+    writeText(cout, PreOrder);
+    cout << endl;
+}
@@ -0,0 +1,287 @@
+#pragma once
+#include <memory>
+#include "ConcurrentRedBlackTree.h"
+using namespace std;
+
+/*  --------------------------------------------------------------
+ Sharded Red-Black Tree: several writers at once for high ingest rates.
+
+ The key space is cut into ranges by sorted splitter values, and each range is
+ stored in its own RedBlackTree (a shard) behind its own reader-biased lock
+ (see ConcurrentRedBlackTree.h). Key k goes to shard i, where i is the number
+ of splitters <= k. Writers to different shards never wait for each other and
+ rebalancing never crosses a shard, so write throughput grows with the number
+ of shards that are busy at the same time. Point lookups lock one shard only.
+
+ As the shards hold disjoint, ordered key ranges, the merged sorted sequence
+ is simply shard 0, then shard 1, ... : forEach / forEachInRange and the
+ iterator visit the shards one after the other, no k-way merge is involved.
+
+ Splitters should come from a sample of the keys (fromSample()), so the shards
+ get similar shares of the load.
+*/
+
+// Sharded Red-Black Tree class ===================================================================
+template <typename T, typename Augment = NoAugment>
+class ShardedRedBlackTree {
+public:
+    typedef RedBlackTree<T, Augment> Tree;
+
+private:
+    struct Shard {
+        mutable ReaderBiasedLock lock;
+        Tree                     tree;
+
+        // The lock is cache-line aligned (see allocateCacheAligned)
+        static void* operator new(size_t size) { return allocateCacheAligned(size); }
+        static void  operator delete(void* p)  { freeCacheAligned(p); }
+    };
+
+    vector<T>                 splitters;    // sorted, splitters.size() + 1 shards
+    vector<unique_ptr<Shard>> shards;       // one heap block per shard (no false sharing)
+
+    size_t shardOf(const T& val) const {
+        return size_t(std::upper_bound(splitters.begin(), splitters.end(), val) - splitters.begin());
+    }
+
+public:
+    // Iterator over the values of every shard in sorted order. It does not lock:
+    // use it only while no writer is running (e.g. between two ingest phases);
+    // forEach() and forEachInRange() are safe at any time.
+    class iterator {
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef T                    value_type;
+        typedef ptrdiff_t            difference_type;
+        typedef const T*             pointer;
+        typedef const T&             reference;
+
+        iterator() : owner(nullptr), shard(0) {}
+        iterator(const ShardedRedBlackTree* o, size_t s) : owner(o), shard(s) {
+            if (shard < owner->shards.size())
+                current = owner->shards[shard]->tree.begin();
+            skipEmpty();
+        }
+
+        reference operator*() const  { return *current; }
+        pointer   operator->() const { return &*current; }
+
+        iterator& operator++() { ++current; skipEmpty(); return *this; }
+        iterator  operator++(int) { iterator old = *this; ++*this; return old; }
+
+        bool operator==(const iterator& other) const {
+            // A default-constructed iterator has no owner (and no current position)
+            return shard == other.shard &&
+                   (owner == nullptr || shard == owner->shards.size() || current == other.current);
+        }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        const ShardedRedBlackTree* owner;
+        size_t                     shard;
+        typename Tree::iterator    current;
+
+        // Move on to the first value of the next non-empty shard at the end of a shard
+        void skipEmpty() {
+            while (shard < owner->shards.size() && current == owner->shards[shard]->tree.end()) {
+                if (++shard < owner->shards.size())
+                    current = owner->shards[shard]->tree.begin();
+            }
+        }
+    };
+    typedef iterator const_iterator;
+
+    ShardedRedBlackTree() : ShardedRedBlackTree(vector<T>()) {}
+    explicit ShardedRedBlackTree(vector<T> splitterValues);
+    template <typename Iter>
+    static unique_ptr<ShardedRedBlackTree> fromSample(Iter first, Iter last, size_t shardCount);
+
+    ShardedRedBlackTree(const ShardedRedBlackTree&) = delete;
+    ShardedRedBlackTree& operator=(const ShardedRedBlackTree&) = delete;
+
+    // Writers - one per shard at a time
+    void   insert(const T& val);
+    void   insert(T&& val);
+    template <typename... Args>
+    void   emplace(Args&&... args);
+    bool   erase(const T& val);
+    template <typename Iter>
+    void   insertBatch(Iter first, Iter last);
+    void   clear();
+
+    // Readers - may run concurrently with the writers
+    bool   contains(const T& val) const;
+    bool   find(const T& val, T& out) const;
+    bool   lowerBound(const T& val, T& out) const;
+    size_t size() const;
+    template <typename Fn>
+    void   forEach(Fn fn) const;
+    template <typename Fn>
+    void   forEachInRange(const T& lo, const T& hi, Fn fn) const;
+
+    size_t           shardCount() const { return shards.size(); }
+    const vector<T>& getSplitters() const { return splitters; }
+
+    // Unlocked iteration (see iterator)
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const   { return iterator(this, shards.size()); }
+};
+// ------------------------------------------------------------------------------------------------
+
+// Build the shards for the given splitters (sorted here if needed)
+template <typename T, typename Augment>
+ShardedRedBlackTree<T, Augment>::ShardedRedBlackTree(vector<T> splitterValues)
+    : splitters(std::move(splitterValues)) {
+    if (!is_sorted(splitters.begin(), splitters.end()))
+        sort(splitters.begin(), splitters.end());
+    for (size_t i = 0; i <= splitters.size(); i++)
+        shards.push_back(unique_ptr<Shard>(new Shard()));
+}
+
+// Create a tree of shardCount shards whose splitters are quantiles of the sample
+// [first, last), so each shard receives about the same share of similar keys.
+// The tree is returned on the heap: it holds locks and cannot be moved.
+template <typename T, typename Augment>
+template <typename Iter>
+unique_ptr<ShardedRedBlackTree<T, Augment>>
+ShardedRedBlackTree<T, Augment>::fromSample(Iter first, Iter last, size_t shardCount) {
+    vector<T> sample(first, last);
+    sort(sample.begin(), sample.end());
+
+    vector<T> picked;
+    for (size_t i = 1; i < shardCount && !sample.empty(); i++) {
+        const T& quantile = sample[i * sample.size() / shardCount];
+        // Equal quantiles would give empty shards
+        if (picked.empty() || picked.back() < quantile)
+            picked.push_back(quantile);
+    }
+    return unique_ptr<ShardedRedBlackTree>(new ShardedRedBlackTree(std::move(picked)));
+}
+
+// Writers -----------------------------------------------------------------
+template <typename T, typename Augment>
+void ShardedRedBlackTree<T, Augment>::insert(const T& val) {
+    Shard& shard = *shards[shardOf(val)];
+    ExclusiveGuard guard(shard.lock);
+    shard.tree.insert(val);
+}
+
+template <typename T, typename Augment>
+void ShardedRedBlackTree<T, Augment>::insert(T&& val) {
+    Shard& shard = *shards[shardOf(val)];
+    ExclusiveGuard guard(shard.lock);
+    shard.tree.insert(std::move(val));
+}
+
+// The value has to exist to pick its shard, so it is built first, then moved in
+template <typename T, typename Augment>
+template <typename... Args>
+void ShardedRedBlackTree<T, Augment>::emplace(Args&&... args) {
+    insert(T(std::forward<Args>(args)...));
+}
+
+template <typename T, typename Augment>
+bool ShardedRedBlackTree<T, Augment>::erase(const T& val) {
+    Shard& shard = *shards[shardOf(val)];
+    ExclusiveGuard guard(shard.lock);
+    return shard.tree.erase(val);
+}
+
+// Insert every value of [first, last): the batch is sorted outside the locks,
+// which also groups it by shard, then each shard takes its part in one insertBatch
+template <typename T, typename Augment>
+template <typename Iter>
+void ShardedRedBlackTree<T, Augment>::insertBatch(Iter first, Iter last) {
+    vector<T> batch(first, last);
+    if (!is_sorted(batch.begin(), batch.end()))
+        sort(batch.begin(), batch.end());
+
+    typename vector<T>::iterator begin = batch.begin();
+    for (size_t i = 0; i < shards.size() && begin != batch.end(); i++) {
+        typename vector<T>::iterator stop =
+            (i < splitters.size()) ? std::lower_bound(begin, batch.end(), splitters[i]) : batch.end();
+        if (begin != stop) {
+            ExclusiveGuard guard(shards[i]->lock);
+            shards[i]->tree.insertBatch(make_move_iterator(begin), make_move_iterator(stop));
+        }
+        begin = stop;
+    }
+}
+
+template <typename T, typename Augment>
+void ShardedRedBlackTree<T, Augment>::clear() {
+    for (size_t i = 0; i < shards.size(); i++) {
+        ExclusiveGuard guard(shards[i]->lock);
+        shards[i]->tree.clear();
+    }
+}
+
+// Readers -----------------------------------------------------------------
+template <typename T, typename Augment>
+bool ShardedRedBlackTree<T, Augment>::contains(const T& val) const {
+    const Shard& shard = *shards[shardOf(val)];
+    SharedGuard guard(shard.lock);
+    return shard.tree.search(val) != nullptr;
+}
+
+// Copy the value equal to val into out. Returns false when val is not in the tree.
+template <typename T, typename Augment>
+bool ShardedRedBlackTree<T, Augment>::find(const T& val, T& out) const {
+    const Shard& shard = *shards[shardOf(val)];
+    SharedGuard guard(shard.lock);
+    typename Tree::TreeNode* node = shard.tree.search(val);
+    if (node == nullptr)
+        return false;
+    out = node->data;
+    return true;
+}
+
+// Copy the first value not less than val into out, looking into the following
+// shards when the shard of val holds nothing as large. Returns false if there is none.
+template <typename T, typename Augment>
+bool ShardedRedBlackTree<T, Augment>::lowerBound(const T& val, T& out) const {
+    for (size_t i = shardOf(val); i < shards.size(); i++) {
+        SharedGuard guard(shards[i]->lock);
+        typename Tree::TreeNode* node = shards[i]->tree.lower_bound(val);
+        if (node != nullptr) {
+            out = node->data;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Total number of values (each shard is counted at a slightly different moment)
+template <typename T, typename Augment>
+size_t ShardedRedBlackTree<T, Augment>::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shards.size(); i++) {
+        SharedGuard guard(shards[i]->lock);
+        total += shards[i]->tree.size();
+    }
+    return total;
+}
+
+// Call fn(data) for every value in sorted order, one shard at a time under its lock
+template <typename T, typename Augment>
+template <typename Fn>
+void ShardedRedBlackTree<T, Augment>::forEach(Fn fn) const {
+    for (size_t i = 0; i < shards.size(); i++) {
+        SharedGuard guard(shards[i]->lock);
+        for (const T& val : shards[i]->tree)
+            fn(val);
+    }
+}
+
+// Call fn(data) for every value in [lo, hi), visiting only the shards of that range
+template <typename T, typename Augment>
+template <typename Fn>
+void ShardedRedBlackTree<T, Augment>::forEachInRange(const T& lo, const T& hi, Fn fn) const {
+    if (!(lo < hi))
+        return;
+    size_t last = shardOf(hi);
+    for (size_t i = shardOf(lo); i <= last && i < shards.size(); i++) {
+        SharedGuard guard(shards[i]->lock);
+        shards[i]->tree.forEachInRange(lo, hi, fn);
+    }
+}